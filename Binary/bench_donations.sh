@@ -0,0 +1,57 @@
+#!/bin/bash
+# End-to-end timings of eff_donations on generated donation files
+#
+# BENCH_ROWS     row counts to try (default: 1000 10000 100000 1000000,
+#                add 10000000 100000000 for production sizes)
+# BENCH_DISTS    gen_donations distributions (default: random sorted zipf)
+# BENCH_THREADS  --threads values (default: 1 and the core count)
+# BENCH_DIR      where generated files go (default: a temp directory)
+set -e
+cd "$(dirname "$0")"
+
+rows_list=${BENCH_ROWS:-"1000 10000 100000 1000000"}
+dists=${BENCH_DISTS:-"random sorted zipf"}
+threads_list=${BENCH_THREADS:-"1 $(nproc)"}
+dir=${BENCH_DIR:-$(mktemp -d)}
+queries=10000
+
+# Print wall milliseconds taken by the command
+ms() {
+  local start end
+  start=$(date +%s%N)
+  "$@" > /dev/null || true
+  end=$(date +%s%N)
+  echo $(( (end - start) / 1000000 ))
+}
+
+printf "%10s %8s %7s %9s %9s %9s %9s %9s %10s\n" rows dist threads \
+  "load ms" "all ms" "rich ms" "cheap ms" "who ms" "who us/q"
+for rows in $rows_list; do
+  for dist in $dists; do
+    data="$dir/donations_${dist}_$rows.dat"
+    [ -f "$data" ] || ./gen_donations "$rows" "$dist" > "$data"
+    # Random who queries spread over the amount range
+    awk -v n="$queries" -v max="$rows" 'BEGIN {
+      srand(7)
+      for (i = 0; i < n; i++) {
+        r = int(rand() * 3)
+        printf "who %s%d\n", r == 1 ? "+" : (r == 2 ? "-" : ""),
+          int(rand() * max) + 1
+      }
+    }' > "$dir/queries_$rows.txt"
+    for threads in $(echo $threads_list | tr ' ' '\n' | sort -un); do
+      run="./eff_donations --threads $threads $data"
+      load=$(ms $run --queries /dev/null)
+      all=$(ms $run all)
+      rich=$(ms $run rich)
+      cheap=$(ms $run cheap)
+      who=$(ms $run who "$rows")
+      batch=$(ms $run --queries "$dir/queries_$rows.txt" --sort-queries)
+      per=$(( (batch - load) * 1000 / queries ))
+      [ $per -ge 0 ] || per=0
+      printf "%10s %8s %7s %9s %9s %9s %9s %9s %10s\n" "$rows" "$dist" \
+        "$threads" "$load" "$all" "$rich" "$cheap" "$who" "$per"
+    done
+  done
+done
+[ -n "$BENCH_DIR" ] || rm -rf "$dir"
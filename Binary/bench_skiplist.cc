@@ -0,0 +1,87 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <numeric>
+#include <random>
+#include <thread>
+#include <vector>
+#include "skiplist.h"
+#include "treemap.h"
+
+// Compare Treemap (behind a mutex when shared) and Skiplist (lock-free
+// inserts and lookups) on random keys
+//
+// Usage: ./bench_skiplist [keys] [max_threads]
+
+// Run @work(thread_id, begin, end) over [0, n) split across @threads,
+// return elapsed seconds
+template <typename F>
+double Run(int threads, int n, F work) {
+  auto start = std::chrono::steady_clock::now();
+  std::vector<std::thread> workers;
+  for (int t = 0; t < threads; t++) {
+    int begin = static_cast<int>(static_cast<long>(n) * t / threads);
+    int end = static_cast<int>(static_cast<long>(n) * (t + 1) / threads);
+    workers.emplace_back(work, begin, end);
+  }
+  for (auto &w : workers) {
+    w.join();
+  }
+  std::chrono::duration<double> d = std::chrono::steady_clock::now() - start;
+  return d.count();
+}
+
+int main(int argc, char *argv[]) {
+  int n = argc > 1 ? atoi(argv[1]) : 1000000;
+  int max_threads = argc > 2 ? atoi(argv[2]) :
+    std::max(1u, std::thread::hardware_concurrency());
+  if (n <= 0 || max_threads <= 0) {
+    std::fprintf(stderr, "Usage: ./bench_skiplist [keys] [max_threads]\n");
+    return 1;
+  }
+  std::vector<int> keys(n);
+  std::iota(keys.begin(), keys.end(), 0);
+  std::shuffle(keys.begin(), keys.end(), std::mt19937(42));
+
+  std::printf("%-10s %8s %14s %14s\n", "map", "threads", "insert Mop/s",
+    "lookup Mop/s");
+  for (int threads = 1; threads <= max_threads; threads *= 2) {
+    double mops = n / 1e6;
+    {
+      Treemap<int, int> map;
+      std::mutex lock;
+      double ins = Run(threads, n, [&](int begin, int end) {
+        for (int i = begin; i < end; i++) {
+          std::lock_guard<std::mutex> guard(lock);
+          map.Insert(keys[i], i);
+        }
+      });
+      double get = Run(threads, n, [&](int begin, int end) {
+        for (int i = begin; i < end; i++) {
+          std::lock_guard<std::mutex> guard(lock);
+          map.Get(keys[i]);
+        }
+      });
+      std::printf("%-10s %8d %14.2f %14.2f\n", "treemap", threads,
+        mops / ins, mops / get);
+    }
+    {
+      Skiplist<int, int> map;
+      double ins = Run(threads, n, [&](int begin, int end) {
+        for (int i = begin; i < end; i++) {
+          map.Insert(keys[i], i);
+        }
+      });
+      double get = Run(threads, n, [&](int begin, int end) {
+        for (int i = begin; i < end; i++) {
+          map.Get(keys[i]);
+        }
+      });
+      std::printf("%-10s %8d %14.2f %14.2f\n", "skiplist", threads,
+        mops / ins, mops / get);
+    }
+  }
+  return 0;
+}
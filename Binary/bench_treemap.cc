@@ -0,0 +1,223 @@
+#include <benchmark/benchmark.h>
+#include <malloc.h>
+#include <algorithm>
+#include <map>
+#include <random>
+#include <stdexcept>
+#include <vector>
+#include "skiplist.h"
+#include "treemap.h"
+
+// Microbenchmarks of Treemap against std::map and Skiplist
+//
+// Every benchmark takes {size, distribution} where distribution 0 inserts
+// keys in random order and 1 in sorted order (Treemap degenerates into a
+// list there, so sorted runs stop at 4096 keys). Keys are even numbers so
+// FloorKey/CeilKey probes on odd numbers always miss.
+//
+// Counters: time/op per operation, bytes/entry of heap (malloc overhead
+// included) held by a built map.
+// Cache misses come from --benchmark_perf_counters=CACHE-MISSES when the
+// benchmark library was built with libpfm.
+
+// Heap bytes in use right now, malloc overhead included
+static long long HeapBytes() {
+  return static_cast<long long>(mallinfo2().uordblks);
+}
+
+// std::map behind Treemap's API
+template <typename K, typename V>
+class StdMap {
+ public:
+  size_t Size() { return map.size(); }
+  bool Empty() { return map.empty(); }
+  void Insert(const K &key, const V &value) {
+    if (!map.emplace(key, value).second) {
+      throw std::invalid_argument("Node already exist");
+    }
+  }
+  void Remove(const K &key) {
+    if (map.erase(key) == 0) {
+      throw std::invalid_argument("key not found");
+    }
+  }
+  const V& Get(const K &key) { return map.at(key); }
+  const K& FloorKey(const K &key) {
+    auto it = map.upper_bound(key);
+    if (it == map.begin()) {
+      throw std::invalid_argument("No smaller key");
+    }
+    return (--it)->first;
+  }
+  const K& CeilKey(const K &key) {
+    auto it = map.lower_bound(key);
+    if (it == map.end()) {
+      throw std::invalid_argument("No larger key");
+    }
+    return it->first;
+  }
+  bool ContainsKey(const K &key) { return map.count(key) != 0; }
+  bool ContainsValue(const V &value) {
+    for (auto &kv : map) {
+      if (kv.second == value) {
+        return true;
+      }
+    }
+    return false;
+  }
+  const K& MaxKey() { return map.rbegin()->first; }
+  const K& MinKey() { return map.begin()->first; }
+
+ private:
+    std::map<K, V> map;
+};
+
+// @n distinct even keys, shuffled unless @sorted
+static std::vector<int> Keys(int n, bool sorted) {
+  std::vector<int> keys(n);
+  for (int i = 0; i < n; i++) {
+    keys[i] = 2 * i;
+  }
+  if (!sorted) {
+    std::shuffle(keys.begin(), keys.end(), std::mt19937(42));
+  }
+  return keys;
+}
+
+// Lookup keys in random order, @odd to probe between stored keys
+static std::vector<int> Probes(int n, bool odd) {
+  std::vector<int> probes = Keys(n, false);
+  if (odd) {
+    for (auto &p : probes) {
+      p++;
+    }
+  }
+  return probes;
+}
+
+template <typename M>
+static void Build(M &map, const std::vector<int> &keys) {
+  for (int k : keys) {
+    map.Insert(k, k);
+  }
+}
+
+// Seconds per operation, printed with an SI prefix (e.g. 85n)
+static void PerOp(benchmark::State &state, size_t ops_per_iteration) {
+  state.counters["time/op"] = benchmark::Counter(
+    static_cast<double>(ops_per_iteration),
+    benchmark::Counter::kIsIterationInvariantRate |
+    benchmark::Counter::kInvert);
+}
+
+template <typename M>
+static void BM_Insert(benchmark::State &state) {
+  std::vector<int> keys = Keys(state.range(0), state.range(1));
+  long long bytes = 0;
+  for (auto _ : state) {
+    long long before = HeapBytes();
+    M *map = new M;
+    Build(*map, keys);
+    bytes = HeapBytes() - before;
+    state.PauseTiming();
+    delete map;
+    state.ResumeTiming();
+  }
+  PerOp(state, keys.size());
+  state.counters["bytes/entry"] = static_cast<double>(bytes) / keys.size();
+}
+
+template <typename M>
+static void BM_Remove(benchmark::State &state) {
+  std::vector<int> keys = Keys(state.range(0), state.range(1));
+  std::vector<int> order = Probes(state.range(0), false);
+  for (auto _ : state) {
+    state.PauseTiming();
+    M *map = new M;
+    Build(*map, keys);
+    state.ResumeTiming();
+    for (int k : order) {
+      map->Remove(k);
+    }
+    state.PauseTiming();
+    delete map;
+    state.ResumeTiming();
+  }
+  PerOp(state, keys.size());
+}
+
+// One lookup per iteration, cycling through @probes
+template <typename M, typename F>
+static void Lookup(benchmark::State &state, bool odd, F op) {
+  M map;
+  Build(map, Keys(state.range(0), state.range(1)));
+  std::vector<int> probes = Probes(state.range(0), odd);
+  size_t i = 0;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(op(map, probes[i]));
+    if (++i == probes.size()) {
+      i = 0;
+    }
+  }
+  PerOp(state, 1);
+}
+
+template <typename M>
+static void BM_Get(benchmark::State &state) {
+  Lookup<M>(state, false, [](M &m, int k) { return m.Get(k); });
+}
+
+template <typename M>
+static void BM_FloorKey(benchmark::State &state) {
+  Lookup<M>(state, true, [](M &m, int k) { return m.FloorKey(k); });
+}
+
+template <typename M>
+static void BM_CeilKey(benchmark::State &state) {
+  // Probe below the largest key so every call has an answer
+  int max = 2 * (state.range(0) - 1);
+  Lookup<M>(state, true, [max](M &m, int k) {
+    return m.CeilKey(std::min(k, max));
+  });
+}
+
+template <typename M>
+static void BM_ContainsValue(benchmark::State &state) {
+  // Missing value, so the whole map is scanned
+  Lookup<M>(state, false, [](M &m, int) { return m.ContainsValue(-1); });
+}
+
+template <typename M>
+static void BM_MinMaxKey(benchmark::State &state) {
+  Lookup<M>(state, false, [](M &m, int) {
+    return m.MinKey() + m.MaxKey();
+  });
+}
+
+static void RandomSizes(benchmark::internal::Benchmark *b) {
+  for (int n = 1 << 10; n <= 1 << 20; n <<= 2) {
+    b->Args({n, 0});
+  }
+  b->Args({1 << 10, 1})->Args({1 << 12, 1});
+}
+
+static void ScanSizes(benchmark::internal::Benchmark *b) {
+  for (int n = 1 << 10; n <= 1 << 16; n <<= 3) {
+    b->Args({n, 0});
+  }
+}
+
+#define BENCH_MAPS(name, sizes) \
+  BENCHMARK_TEMPLATE(name, Treemap<int, int>)->Apply(sizes); \
+  BENCHMARK_TEMPLATE(name, StdMap<int, int>)->Apply(sizes); \
+  BENCHMARK_TEMPLATE(name, Skiplist<int, int>)->Apply(sizes)
+
+BENCH_MAPS(BM_Insert, RandomSizes);
+BENCH_MAPS(BM_Remove, RandomSizes);
+BENCH_MAPS(BM_Get, RandomSizes);
+BENCH_MAPS(BM_FloorKey, RandomSizes);
+BENCH_MAPS(BM_CeilKey, RandomSizes);
+BENCH_MAPS(BM_ContainsValue, ScanSizes);
+BENCH_MAPS(BM_MinMaxKey, RandomSizes);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,291 @@
+#ifndef DONATION_LOADER_H_
+#define DONATION_LOADER_H_
+
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <climits>
+#include <cstring>
+#include <exception>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#include "treemap.h"
+
+// Read-only memory mapping of a whole file
+class MappedFile {
+ public:
+  MappedFile() : data(nullptr), size(0) {}
+  ~MappedFile() { Close(); }
+  MappedFile(const MappedFile &) = delete;
+  MappedFile &operator=(const MappedFile &) = delete;
+
+  // Map @path, return false if it cannot be opened or mapped
+  bool Open(const char *path);
+  void Close();
+
+  const char* Data() const { return data; }
+  size_t Size() const { return size; }
+
+ private:
+    const char *data;
+    size_t size;
+};
+
+inline bool MappedFile::Open(const char *path) {
+  Close();
+  int fd = open(path, O_RDONLY);
+  if (fd < 0) {
+    return false;
+  }
+  struct stat st;
+  if (fstat(fd, &st) != 0) {
+    close(fd);
+    return false;
+  }
+  size = static_cast<size_t>(st.st_size);
+  // mmap rejects zero-length mappings, an empty file is just empty
+  if (size > 0) {
+    void *p = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (p == MAP_FAILED) {
+      close(fd);
+      size = 0;
+      return false;
+    }
+    madvise(p, size, MADV_SEQUENTIAL);
+    data = static_cast<const char*>(p);
+  }
+  close(fd);
+  return true;
+}
+
+inline void MappedFile::Close() {
+  if (data) {
+    munmap(const_cast<char*>(data), size);
+  }
+  data = nullptr;
+  size = 0;
+}
+
+// Write all of @data to @fd, return false if the write fails
+inline bool WriteAll(int fd, const std::string &data) {
+  const char *p = data.data();
+  size_t left = data.size();
+  while (left > 0) {
+    ssize_t n = write(fd, p, left);
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n <= 0) {
+      return false;
+    }
+    p += n;
+    left -= n;
+  }
+  return true;
+}
+
+// Parse a decimal integer in [@begin, @end), surrounding blanks allowed,
+// throw std::invalid_argument on anything else or std::out_of_range on
+// overflow
+inline int ParseAmount(const char *begin, const char *end) {
+  while (begin < end && (*begin == ' ' || *begin == '\t')) {
+    begin++;
+  }
+  while (end > begin && (end[-1] == ' ' || end[-1] == '\t' ||
+    end[-1] == '\r')) {
+    end--;
+  }
+  bool negative = false;
+  if (begin < end && (*begin == '+' || *begin == '-')) {
+    negative = (*begin == '-');
+    begin++;
+  }
+  if (begin == end) {
+    throw std::invalid_argument("Invalid amount");
+  }
+  long long value = 0;
+  for (; begin < end; begin++) {
+    unsigned digit = static_cast<unsigned>(*begin - '0');
+    if (digit > 9) {
+      throw std::invalid_argument("Invalid amount");
+    }
+    value = value * 10 + digit;
+    if (value > static_cast<long long>(INT_MAX) + 1) {
+      throw std::out_of_range("Amount out of range");
+    }
+  }
+  if (negative) {
+    value = -value;
+  }
+  if (value > INT_MAX) {
+    throw std::out_of_range("Amount out of range");
+  }
+  return static_cast<int>(value);
+}
+
+// Call @emit(name, name_length, amount) for every "name,amount" line in
+// [@begin, @end) without copying; the amount follows the last comma so
+// names may contain commas, and lines without one are skipped
+template <typename F>
+void ParseDonations(const char *begin, const char *end, F emit) {
+  while (begin < end) {
+    const char *eol = static_cast<const char*>(
+      memchr(begin, '\n', end - begin));
+    if (!eol) {
+      eol = end;
+    }
+    const char *comma = eol;
+    while (comma > begin && comma[-1] != ',') {
+      comma--;
+    }
+    if (comma > begin) {
+      emit(begin, static_cast<size_t>(comma - 1 - begin),
+        ParseAmount(comma, eol));
+    }
+    begin = eol + 1;
+  }
+}
+
+// One parsed row, the name points into the mapped file
+struct Donation {
+  int amount;
+  const char *name;
+  size_t length;
+};
+
+inline bool operator<(const Donation &a, const Donation &b) {
+  return a.amount < b.amount;
+}
+
+// Split [@begin, @end) into at most @parts pieces that end on line
+// boundaries, return the piece boundaries including both ends
+inline std::vector<const char*> SplitLines(const char *begin, const char *end,
+  int parts) {
+  // An empty file maps to no memory at all, so there is nothing to search
+  if (end == begin) {
+    return std::vector<const char*>{begin, end};
+  }
+  std::vector<const char*> cuts(1, begin);
+  size_t step = (end - begin) / parts;
+  for (int i = 1; i < parts; i++) {
+    const char *cut = std::max(cuts.back(), begin + i * step);
+    const char *eol = static_cast<const char*>(memchr(cut, '\n', end - cut));
+    if (!eol) {
+      break;
+    }
+    if (eol + 1 > cuts.back()) {
+      cuts.push_back(eol + 1);
+    }
+  }
+  cuts.push_back(end);
+  return cuts;
+}
+
+// Run @work(i) for i in [0, @count) on up to @count threads, rethrowing the
+// first exception on the calling thread
+template <typename F>
+void ParallelFor(int count, F work) {
+  std::vector<std::exception_ptr> errors(count);
+  std::vector<std::thread> workers;
+  for (int i = 1; i < count; i++) {
+    workers.emplace_back([&work, &errors, i]() {
+      try {
+        work(i);
+      } catch (...) {
+        errors[i] = std::current_exception();
+      }
+    });
+  }
+  try {
+    work(0);
+  } catch (...) {
+    errors[0] = std::current_exception();
+  }
+  for (auto &w : workers) {
+    w.join();
+  }
+  for (auto &e : errors) {
+    if (e) {
+      std::rethrow_exception(e);
+    }
+  }
+}
+
+// Parse [@begin, @end) into one sorted run per chunk on @threads threads,
+// then merge the runs pairwise (each round in parallel) into one sorted run
+inline std::vector<Donation> SortedDonations(const char *begin,
+  const char *end, int threads) {
+  std::vector<const char*> cuts = SplitLines(begin, end, threads);
+  std::vector<std::vector<Donation>> runs(cuts.size() - 1);
+  ParallelFor(static_cast<int>(runs.size()), [&cuts, &runs](int i) {
+    std::vector<Donation> &run = runs[i];
+    ParseDonations(cuts[i], cuts[i + 1],
+      [&run](const char *name, size_t len, int amount) {
+        run.push_back(Donation{amount, name, len});
+      });
+    std::sort(run.begin(), run.end());
+  });
+  while (runs.size() > 1) {
+    std::vector<std::vector<Donation>> merged(runs.size() / 2);
+    ParallelFor(static_cast<int>(merged.size()), [&runs, &merged](int i) {
+      std::vector<Donation> &a = runs[2 * i];
+      std::vector<Donation> &b = runs[2 * i + 1];
+      merged[i].resize(a.size() + b.size());
+      std::merge(a.begin(), a.end(), b.begin(), b.end(), merged[i].begin());
+      std::vector<Donation>().swap(a);
+      std::vector<Donation>().swap(b);
+    });
+    if (runs.size() % 2) {
+      merged.push_back(std::move(runs.back()));
+    }
+    runs.swap(merged);
+  }
+  return runs.empty() ? std::vector<Donation>() : std::move(runs[0]);
+}
+
+// Insert sorted @rows in [@lo, @hi) middle first, so the Treemap comes out
+// balanced whatever order the file was in
+inline void InsertBalanced(const std::vector<Donation> &rows, size_t lo,
+  size_t hi, Treemap<int, std::string> &donation, std::string &name) {
+  if (lo >= hi) {
+    return;
+  }
+  size_t mid = lo + (hi - lo) / 2;
+  name.assign(rows[mid].name, rows[mid].length);
+  donation.Insert(rows[mid].amount, name);
+  InsertBalanced(rows, lo, mid, donation, name);
+  InsertBalanced(rows, mid + 1, hi, donation, name);
+}
+
+// Build @donation from sorted @rows; a repeated amount throws
+// std::invalid_argument just like Treemap::Insert
+inline void BuildDonations(const std::vector<Donation> &rows,
+  Treemap<int, std::string> &donation) {
+  for (size_t i = 1; i < rows.size(); i++) {
+    if (rows[i].amount == rows[i - 1].amount) {
+      throw std::invalid_argument("Node already exist");
+    }
+  }
+  std::string name;
+  InsertBalanced(rows, 0, rows.size(), donation, name);
+}
+
+// Load donations in @path into @donation using @threads parsing threads,
+// return false if the file cannot be opened
+inline bool LoadDonations(const char *path,
+  Treemap<int, std::string> &donation, int threads = 1) {
+  MappedFile file;
+  if (!file.Open(path)) {
+    return false;
+  }
+  BuildDonations(SortedDonations(file.Data(), file.Data() + file.Size(),
+    threads), donation);
+  return true;
+}
+
+#endif  // DONATION_LOADER_H_
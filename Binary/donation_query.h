@@ -0,0 +1,238 @@
+#ifndef DONATION_QUERY_H_
+#define DONATION_QUERY_H_
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "donation_loader.h"
+#include "treemap.h"
+
+// Result of answering one command
+enum QueryStatus {
+  kQueryOk,
+  kQueryNoMatch,
+  kQueryInvalid
+};
+
+// Append "name (amount)" for @amount to @out
+inline void PrintDonation(Treemap<int, std::string> &donation, int amount,
+  std::string &out) {
+  out += donation.Get(amount);
+  out += " (";
+  out += std::to_string(amount);
+  out += ")\n";
+}
+
+// Append every donor and amount in increasing order to @out
+inline void PrintAll(Treemap<int, std::string> &donation, std::string &out) {
+  if (donation.Empty()) {
+    return;
+  }
+  int key = donation.MinKey();
+  int max = donation.MaxKey();
+  while (true) {
+    PrintDonation(donation, key, out);
+    if (key == max) {
+      break;
+    }
+    key = donation.CeilKey(key + 1);
+  }
+}
+
+// Find the amount equal to (' '), just above ('+') or just below ('-')
+// @amount, return false if there is none
+inline bool FindDonation(Treemap<int, std::string> &donation, int amount,
+  char choice, int *result) {
+  if (donation.Empty()) {
+    return false;
+  }
+  if (choice == '+') {
+    if (donation.MaxKey() <= amount) {
+      return false;
+    }
+    *result = donation.CeilKey(amount + 1);
+  } else if (choice == '-') {
+    if (donation.MinKey() >= amount) {
+      return false;
+    }
+    *result = donation.FloorKey(amount - 1);
+  } else {
+    if (!donation.ContainsKey(amount)) {
+      return false;
+    }
+    *result = amount;
+  }
+  return true;
+}
+
+// Split "[+/-]amount" in [@begin, @end), blanks allowed around it, into
+// @choice and @amount, throw std::invalid_argument or std::out_of_range if
+// it is not a number
+inline void ParseWho(const char *begin, const char *end, char *choice,
+  int *amount) {
+  while (begin < end && (*begin == ' ' || *begin == '\t')) {
+    begin++;
+  }
+  *choice = ' ';
+  if (begin < end && (*begin == '+' || *begin == '-')) {
+    *choice = *begin;
+    begin++;
+  }
+  *amount = ParseAmount(begin, end);
+}
+
+// Answer the "all|cheap|rich|who [+/-]amount" command in [@begin, @end),
+// appending the reply to @out or the reason it is invalid to @error
+inline QueryStatus AnswerQuery(Treemap<int, std::string> &donation,
+  const char *begin, const char *end, std::string &out, std::string &error) {
+  while (end > begin && (end[-1] == '\r' || end[-1] == ' ')) {
+    end--;
+  }
+  const char *space = static_cast<const char*>(memchr(begin, ' ',
+    end - begin));
+  std::string command(begin, space ? space : end);
+  if (command != "all" && command != "rich" && command != "cheap" &&
+    command != "who") {
+    error = "Command '" + command + "' is invalid\n"
+      "Possible commands are: all|cheap|rich|who";
+    return kQueryInvalid;
+  }
+  if (command == "who") {
+    if (!space) {
+      error = "Command 'who' expects another argument: [+/-]amount";
+      return kQueryInvalid;
+    }
+    char choice;
+    int amount;
+    int result;
+    try {
+      ParseWho(space + 1, end, &choice, &amount);
+    } catch (const std::exception &) {
+      error = "Invalid amount '" + std::string(space + 1, end) + "'";
+      return kQueryInvalid;
+    }
+    if (!FindDonation(donation, amount, choice, &result)) {
+      out += "No match\n";
+      return kQueryNoMatch;
+    }
+    PrintDonation(donation, result, out);
+  } else if (space) {
+    error = "Command '" + command + "' takes no arguments";
+    return kQueryInvalid;
+  } else if (command == "all") {
+    PrintAll(donation, out);
+  } else if (donation.Empty()) {
+    out += "No match\n";
+    return kQueryNoMatch;
+  } else if (command == "rich") {
+    PrintDonation(donation, donation.MaxKey(), out);
+  } else {
+    PrintDonation(donation, donation.MinKey(), out);
+  }
+  return kQueryOk;
+}
+
+// Batch output is written out once this much is pending
+const size_t kBatchFlushBytes = 1 << 22;
+
+// One line of a query batch, answered ahead of time if it is a valid "who"
+struct BatchQuery {
+  const char *begin;
+  const char *end;
+  bool is_who;
+  char choice;
+  int amount;
+  const std::string *name;
+  int result;
+};
+
+inline bool operator<(const BatchQuery &a, const BatchQuery &b) {
+  return a.amount < b.amount;
+}
+
+// Answer every command line in [@begin, @end) in order, passing the output
+// to @flush(out) in large blocks and stopping early if it returns false;
+// with @sorted, "who" lookups are done in increasing amount order first so
+// consecutive searches share tree paths, then replies are emitted in the
+// original order. Invalid lines get an "Error: ..." reply. Return the
+// number of lines answered that were not kQueryOk
+template <typename F>
+size_t AnswerQueryBatch(Treemap<int, std::string> &donation, const char *begin,
+  const char *end, bool sorted, F flush) {
+  std::vector<BatchQuery> queries;
+  while (begin < end) {
+    const char *eol = static_cast<const char*>(
+      memchr(begin, '\n', end - begin));
+    if (!eol) {
+      eol = end;
+    }
+    const char *line_end = eol;
+    while (line_end > begin && (line_end[-1] == '\r' || line_end[-1] == ' ')) {
+      line_end--;
+    }
+    if (line_end > begin) {
+      BatchQuery q = {begin, line_end, false, ' ', 0, nullptr, 0};
+      if (sorted && line_end - begin > 4 && memcmp(begin, "who ", 4) == 0) {
+        try {
+          ParseWho(begin + 4, line_end, &q.choice, &q.amount);
+          q.is_who = true;
+        } catch (const std::exception &) {
+        }
+      }
+      queries.push_back(q);
+    }
+    begin = eol + 1;
+  }
+
+  if (sorted) {
+    std::vector<BatchQuery*> order;
+    for (auto &q : queries) {
+      if (q.is_who) {
+        order.push_back(&q);
+      }
+    }
+    std::sort(order.begin(), order.end(),
+      [](const BatchQuery *a, const BatchQuery *b) { return *a < *b; });
+    for (auto q : order) {
+      if (FindDonation(donation, q->amount, q->choice, &q->result)) {
+        q->name = &donation.Get(q->result);
+      }
+    }
+  }
+
+  size_t failed = 0;
+  std::string out;
+  std::string error;
+  for (auto &q : queries) {
+    if (q.is_who) {
+      if (q.name) {
+        out += *q.name;
+        out += " (";
+        out += std::to_string(q.result);
+        out += ")\n";
+      } else {
+        out += "No match\n";
+        failed++;
+      }
+    } else if (AnswerQuery(donation, q.begin, q.end, out, error) !=
+      kQueryOk) {
+      failed++;
+      if (!error.empty()) {
+        out += "Error: " + error + "\n";
+        error.clear();
+      }
+    }
+    if (out.size() >= kBatchFlushBytes) {
+      if (!flush(out)) {
+        return failed;
+      }
+      out.clear();
+    }
+  }
+  flush(out);
+  return failed;
+}
+
+#endif  // DONATION_QUERY_H_
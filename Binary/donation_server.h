@@ -0,0 +1,144 @@
+#ifndef DONATION_SERVER_H_
+#define DONATION_SERVER_H_
+
+#include <errno.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <cstring>
+#include <string>
+#include "donation_query.h"
+#include "treemap.h"
+
+// Replies are flushed once this much output is pending
+const size_t kServerFlushBytes = 1 << 16;
+
+// An idle server calls its tick at least this often
+const int kServerTickMs = 1000;
+
+// Wait until @fd can be read, calling @tick() every kServerTickMs until
+// then; return false if poll fails
+template <typename F>
+bool WaitReadable(int fd, F &tick) {
+  while (true) {
+    pollfd p = {fd, POLLIN, 0};
+    int ready = poll(&p, 1, kServerTickMs);
+    if (ready > 0) {
+      return true;
+    }
+    if (ready < 0 && errno != EINTR) {
+      return false;
+    }
+    if (ready == 0) {
+      tick();
+    }
+  }
+}
+
+// Answer one command per line read from @in_fd until end of input or
+// "quit", writing replies to @out_fd; replies are buffered and flushed once
+// per read so a pipelined batch costs one write, not one per line. @tick()
+// runs between batches and while waiting for input, so it may update
+// @donation (see eff_donations, which follows the delta log with it)
+template <typename F>
+void ServeDonations(Treemap<int, std::string> &donation, int in_fd,
+  int out_fd, F tick) {
+  std::string pending;
+  std::string out;
+  std::string error;
+  char buffer[1 << 16];
+  bool done = false;
+  while (!done) {
+    if (!WaitReadable(in_fd, tick)) {
+      return;
+    }
+    ssize_t n = read(in_fd, buffer, sizeof(buffer));
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n <= 0) {
+      // Answer a last line that has no newline
+      done = true;
+      if (pending.empty()) {
+        break;
+      }
+      pending += '\n';
+    } else {
+      pending.append(buffer, n);
+    }
+    size_t start = 0;
+    size_t eol;
+    while ((eol = pending.find('\n', start)) != std::string::npos) {
+      const char *line = pending.data() + start;
+      const char *line_end = pending.data() + eol;
+      start = eol + 1;
+      if (line == line_end) {
+        continue;
+      }
+      if (std::string(line, line_end) == "quit") {
+        done = true;
+        break;
+      }
+      if (AnswerQuery(donation, line, line_end, out, error) ==
+        kQueryInvalid) {
+        out += "Error: " + error + "\n";
+      }
+      if (out.size() >= kServerFlushBytes) {
+        if (!WriteAll(out_fd, out)) {
+          return;
+        }
+        out.clear();
+      }
+    }
+    pending.erase(0, start);
+    if (!WriteAll(out_fd, out)) {
+      return;
+    }
+    out.clear();
+    tick();
+  }
+}
+
+// Listen on the Unix socket @path and serve each connection in turn,
+// calling @tick() as ServeDonations does; only returns (false) if the
+// socket cannot be set up or accept fails
+template <typename F>
+bool ServeDonationsSocket(Treemap<int, std::string> &donation,
+  const char *path, F tick) {
+  sockaddr_un addr;
+  if (strlen(path) >= sizeof(addr.sun_path)) {
+    return false;
+  }
+  memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  strcpy(addr.sun_path, path);
+  int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (listener < 0) {
+    return false;
+  }
+  unlink(path);
+  if (bind(listener, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 ||
+    listen(listener, 16) != 0) {
+    close(listener);
+    return false;
+  }
+  // A client hanging up mid-reply must not kill the server
+  signal(SIGPIPE, SIG_IGN);
+  while (WaitReadable(listener, tick)) {
+    int client = accept(listener, nullptr, nullptr);
+    if (client < 0) {
+      if (errno == EINTR || errno == ECONNABORTED) {
+        continue;
+      }
+      break;
+    }
+    ServeDonations(donation, client, client, tick);
+    close(client);
+  }
+  close(listener);
+  return false;
+}
+
+#endif  // DONATION_SERVER_H_
@@ -0,0 +1,286 @@
+#ifndef DONATION_SNAPSHOT_H_
+#define DONATION_SNAPSHOT_H_
+
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "donation_loader.h"
+#include "treemap.h"
+
+// A snapshot is kSnapshotMagic followed by one record per donation in
+// increasing amount order: int32 amount, uint32 name length, name bytes.
+// Being sorted already, it loads without parsing text or sorting.
+const char kSnapshotMagic[8] = {'D', 'O', 'N', 'S', 'N', 'A', 'P', '1'};
+
+// Delta log lines are "+name,amount" to add (or replace) a donation and
+// "-amount" to remove one. Every entry sets or clears a single amount, so
+// replaying a log on a snapshot that already contains it changes nothing.
+//
+// Appenders only ever add whole lines at the end, holding an exclusive
+// flock on the log while they write (e.g. with flock(1)). Readers take a
+// shared lock and compaction an exclusive one from the read that folds the
+// log into the snapshot to the truncation that empties it, so no entry can
+// be appended in between and lost. Only one process may compact a log.
+
+inline bool IsSnapshot(const char *begin, const char *end) {
+  return static_cast<size_t>(end - begin) >= sizeof(kSnapshotMagic) &&
+    memcmp(begin, kSnapshotMagic, sizeof(kSnapshotMagic)) == 0;
+}
+
+// Return the rows of the snapshot in [@begin, @end), names point into it;
+// throw std::runtime_error if it is truncated or out of order
+inline std::vector<Donation> SnapshotDonations(const char *begin,
+  const char *end) {
+  std::vector<Donation> rows;
+  const char *p = begin + sizeof(kSnapshotMagic);
+  while (p < end) {
+    int32_t amount;
+    uint32_t length;
+    if (static_cast<size_t>(end - p) < sizeof(amount) + sizeof(length)) {
+      throw std::runtime_error("Corrupt snapshot");
+    }
+    memcpy(&amount, p, sizeof(amount));
+    memcpy(&length, p + sizeof(amount), sizeof(length));
+    p += sizeof(amount) + sizeof(length);
+    if (static_cast<size_t>(end - p) < length ||
+      (!rows.empty() && rows.back().amount >= amount)) {
+      throw std::runtime_error("Corrupt snapshot");
+    }
+    rows.push_back(Donation{amount, p, length});
+    p += length;
+  }
+  return rows;
+}
+
+// Load a donations file or a snapshot (told apart by the magic) from @path
+// into @donation, set @snapshot to which one it was; return false if the
+// file cannot be opened
+inline bool LoadDonationIndex(const char *path,
+  Treemap<int, std::string> &donation, int threads, bool *snapshot) {
+  MappedFile file;
+  if (!file.Open(path)) {
+    return false;
+  }
+  const char *begin = file.Data();
+  const char *end = begin + file.Size();
+  *snapshot = IsSnapshot(begin, end);
+  BuildDonations(*snapshot ? SnapshotDonations(begin, end) :
+    SortedDonations(begin, end, threads), donation);
+  return true;
+}
+
+// Sync the directory holding @path, so a rename into it is on disk
+inline bool SyncParentDirectory(const char *path) {
+  const char *slash = strrchr(path, '/');
+  std::string dir = !slash ? "." :
+    (slash == path ? "/" : std::string(path, slash));
+  int fd = open(dir.c_str(), O_RDONLY | O_DIRECTORY);
+  if (fd < 0) {
+    return false;
+  }
+  bool ok = fsync(fd) == 0;
+  return close(fd) == 0 && ok;
+}
+
+// Write @donation as a snapshot to @path through a temporary file that is
+// synced and renamed over @path, so readers never see a partial snapshot,
+// then sync the directory so the rename survives a power loss too; only
+// then may the log be truncated. Return false on any I/O error
+inline bool WriteSnapshot(Treemap<int, std::string> &donation,
+  const char *path) {
+  std::string tmp = std::string(path) + ".tmp";
+  int fd = open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (fd < 0) {
+    return false;
+  }
+  std::string out(kSnapshotMagic, sizeof(kSnapshotMagic));
+  bool ok = true;
+  if (!donation.Empty()) {
+    int key = donation.MinKey();
+    int max = donation.MaxKey();
+    while (ok) {
+      const std::string &name = donation.Get(key);
+      int32_t amount = key;
+      uint32_t length = static_cast<uint32_t>(name.size());
+      out.append(reinterpret_cast<const char*>(&amount), sizeof(amount));
+      out.append(reinterpret_cast<const char*>(&length), sizeof(length));
+      out += name;
+      if (out.size() >= (1 << 22)) {
+        ok = WriteAll(fd, out);
+        out.clear();
+      }
+      if (key == max) {
+        break;
+      }
+      key = donation.CeilKey(key + 1);
+    }
+  }
+  ok = ok && WriteAll(fd, out) && fsync(fd) == 0;
+  ok = close(fd) == 0 && ok;
+  if (!ok || rename(tmp.c_str(), path) != 0) {
+    unlink(tmp.c_str());
+    return false;
+  }
+  return SyncParentDirectory(path);
+}
+
+// Apply the delta log entries in [@begin, @end) on top of @donation and
+// return how many there were; a malformed line throws
+// std::invalid_argument and leaves @donation unchanged. Only the last entry
+// for an amount matters, and the added amounts are inserted middle first
+// like BuildDonations does, so a sorted log does not degrade the tree
+inline size_t ApplyDeltaLog(Treemap<int, std::string> &donation,
+  const char *begin, const char *end) {
+  // Removals are kept with a null name
+  std::vector<Donation> log;
+  while (begin < end) {
+    const char *eol = static_cast<const char*>(
+      memchr(begin, '\n', end - begin));
+    if (!eol) {
+      eol = end;
+    }
+    if (eol > begin && *begin == '+') {
+      size_t before = log.size();
+      ParseDonations(begin + 1, eol,
+        [&log](const char *name, size_t len, int amount) {
+          log.push_back(Donation{amount, name, len});
+        });
+      if (log.size() == before) {
+        throw std::invalid_argument("Malformed delta log line");
+      }
+    } else if (eol > begin && *begin == '-') {
+      log.push_back(Donation{ParseAmount(begin + 1, eol), nullptr, 0});
+    } else if (eol > begin && !(eol - begin == 1 && *begin == '\r')) {
+      throw std::invalid_argument("Malformed delta log line");
+    }
+    begin = eol + 1;
+  }
+
+  std::stable_sort(log.begin(), log.end());
+  std::vector<Donation> added;
+  for (size_t i = 0; i < log.size(); i++) {
+    if (i + 1 < log.size() && log[i + 1].amount == log[i].amount) {
+      continue;
+    }
+    if (donation.ContainsKey(log[i].amount)) {
+      donation.Remove(log[i].amount);
+    }
+    if (log[i].name) {
+      added.push_back(log[i]);
+    }
+  }
+  std::string name;
+  InsertBalanced(added, 0, added.size(), donation, name);
+  return log.size();
+}
+
+// Open the delta log @path with @flags and take the flock @operation on
+// it; return the descriptor, or -1 with errno set
+inline int LockDeltaLog(const char *path, int flags, int operation) {
+  int fd = open(path, flags, 0644);
+  if (fd < 0) {
+    return -1;
+  }
+  while (flock(fd, operation) != 0) {
+    if (errno != EINTR) {
+      int error = errno;
+      close(fd);
+      errno = error;
+      return -1;
+    }
+  }
+  return fd;
+}
+
+// Read the locked log @fd from @*offset to its end into @out and move
+// @*offset there; a log shorter than @*offset was compacted, so it is read
+// from the start. Return false on a read error
+inline bool ReadDeltaLog(int fd, size_t *offset, std::string &out) {
+  struct stat st;
+  if (fstat(fd, &st) != 0) {
+    return false;
+  }
+  size_t size = static_cast<size_t>(st.st_size);
+  if (size < *offset) {
+    *offset = 0;
+  }
+  out.resize(size - *offset);
+  size_t done = 0;
+  while (done < out.size()) {
+    ssize_t n = pread(fd, &out[done], out.size() - done, *offset + done);
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n <= 0) {
+      return false;
+    }
+    done += n;
+  }
+  *offset = size;
+  return true;
+}
+
+// Apply the entries appended to the delta log in @path since @*offset on
+// top of @donation, move @*offset past them and return how many there
+// were; a missing log counts as empty. Throw std::runtime_error if the log
+// cannot be read and std::invalid_argument on a malformed line
+inline size_t ApplyDeltaLog(Treemap<int, std::string> &donation,
+  const char *path, size_t *offset) {
+  int fd = LockDeltaLog(path, O_RDONLY, LOCK_SH);
+  if (fd < 0) {
+    if (errno == ENOENT) {
+      return 0;
+    }
+    throw std::runtime_error("Cannot lock delta log");
+  }
+  std::string data;
+  size_t at = *offset;
+  bool ok = ReadDeltaLog(fd, &at, data);
+  close(fd);
+  if (!ok) {
+    throw std::runtime_error("Cannot read delta log");
+  }
+  size_t entries = ApplyDeltaLog(donation, data.data(),
+    data.data() + data.size());
+  *offset = at;
+  return entries;
+}
+
+// Fold the delta log in @log_path into the snapshot @snapshot_path: with
+// the log locked, apply what was appended since @*offset to @donation,
+// write the snapshot and empty the log, then reset @*offset. Return false
+// on an I/O error, leaving the log as it was; a malformed line throws
+// std::invalid_argument
+inline bool CompactDeltaLog(Treemap<int, std::string> &donation,
+  const char *log_path, const char *snapshot_path, size_t *offset) {
+  int fd = LockDeltaLog(log_path, O_RDWR | O_CREAT, LOCK_EX);
+  if (fd < 0) {
+    return false;
+  }
+  std::string data;
+  bool ok = ReadDeltaLog(fd, offset, data);
+  try {
+    if (ok) {
+      ApplyDeltaLog(donation, data.data(), data.data() + data.size());
+    }
+  } catch (...) {
+    close(fd);
+    throw;
+  }
+  ok = ok && WriteSnapshot(donation, snapshot_path) && ftruncate(fd, 0) == 0;
+  if (ok) {
+    *offset = 0;
+  }
+  return close(fd) == 0 && ok;
+}
+
+#endif  // DONATION_SNAPSHOT_H_
@@ -1,118 +1,216 @@
+#include <chrono>
 #include <iostream>
-#include <fstream>
 #include <string>
-#include<vector>
+#include "donation_loader.h"
+#include "donation_query.h"
+#include "donation_server.h"
+#include "donation_snapshot.h"
 #include "treemap.h"
 
-// Function for printing all donors and amount
-void all(Treemap<int, std::string> &donation) {
-  int min = donation.MinKey();
-  for (int i = 0; i < 10; i++) {
-    std::cout << donation.Get(min) << " (" << min << ")" << std::endl;
-    if (min < donation.MaxKey()) {
-      min = donation.CeilKey(min + 1);
-    }
-  }
-}
-
-// Function for finding the amount whether smaller, larger or equal
-int find(Treemap<int, std::string> &donation, int amount, char choice) {
-  if (choice == ' ') {
-    if (donation.ContainsKey(amount)) {
-    } else {
-      std::cout << "No match" << std::endl;
-      exit(1);
-    }
-  } else if (choice == '+') {
-    if (donation.MaxKey() >= amount) {
-      amount = donation.CeilKey(amount + 1);
-    } else {
-      std::cout << "No match" << std::endl;
-      exit(1);
-    }
-  } else if (choice == '-') {
-    if (donation.MinKey() <= amount) {
-      amount = donation.FloorKey(amount - 1);
+int main(int argc, char *argv[]) {
+  // Pull options out of argv so the positional arguments stay in place
+  int threads = 1;
+  const char *socket_path = nullptr;
+  const char *queries_path = nullptr;
+  bool sort_queries = false;
+  const char *log_path = nullptr;
+  size_t compact_after = 0;
+  int count = 1;
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    if (arg == "--threads") {
+      if (i + 1 >= argc || (threads = atoi(argv[i + 1])) <= 0) {
+        std::cerr << "Error: --threads expects a positive number"
+        << std::endl;
+        return 1;
+      }
+      i++;
+    } else if (arg == "--socket") {
+      if (i + 1 >= argc) {
+        std::cerr << "Error: --socket expects a path" << std::endl;
+        return 1;
+      }
+      socket_path = argv[++i];
+    } else if (arg == "--queries") {
+      if (i + 1 >= argc) {
+        std::cerr << "Error: --queries expects a file" << std::endl;
+        return 1;
+      }
+      queries_path = argv[++i];
+    } else if (arg == "--sort-queries") {
+      sort_queries = true;
+    } else if (arg == "--log") {
+      if (i + 1 >= argc) {
+        std::cerr << "Error: --log expects a file" << std::endl;
+        return 1;
+      }
+      log_path = argv[++i];
+    } else if (arg == "--compact-after") {
+      int entries;
+      if (i + 1 >= argc || (entries = atoi(argv[i + 1])) <= 0) {
+        std::cerr << "Error: --compact-after expects a positive number"
+        << std::endl;
+        return 1;
+      }
+      compact_after = entries;
+      i++;
     } else {
-      std::cout << "No match" << std::endl;
-      exit(1);
+      argv[count++] = argv[i];
     }
   }
-  return amount;
-}
+  argv[count] = nullptr;
 
-int main(int argc, char *argv[]) {
   // Check to see if arguments are complete
-  if (argv[1] && argv[2]) {
+  if (argv[1] && (argv[2] || queries_path)) {
   } else {
-    std::cerr << "Usage: ./eff_donations <donations_file.dat>"
+    std::cerr << "Usage: ./eff_donations [--threads N] <donations_file.dat>"
     << " <command> [<args>]" << std::endl;
+    std::cerr << "       ./eff_donations [--threads N] <donations_file.dat>"
+    << " serve [--socket <path>]" << std::endl;
+    std::cerr << "       ./eff_donations [--threads N] <donations_file.dat>"
+    << " --queries <queries.txt> [--sort-queries]" << std::endl;
+    std::cerr << "       ./eff_donations <donations_file.dat>"
+    << " [--log <delta.log>] compact [<snapshot>]" << std::endl;
+    std::cerr << "Any data file may be a snapshot, --log applies a delta log"
+    << " on top of it and" << std::endl;
+    std::cerr << "--compact-after N folds a log of N or more entries back"
+    << " into the snapshot; a server" << std::endl;
+    std::cerr << "applies new log entries every second and compacts as it"
+    << " goes. Append to the log" << std::endl;
+    std::cerr << "holding an exclusive lock on it, e.g. flock <delta.log>"
+    << " sh -c 'echo +name,5 >> <delta.log>'" << std::endl;
     return 1;
   }
-  std::string input2 = argv[2];
-  char input3;
-  int amount;
+  std::string input2 = argv[2] ? argv[2] : "";
   // Check to see if arguments are complete with "who"
-  if (input2 == "who") {
-    if (!argv[3]) {
-      std::cerr << "Command 'who' expects another argument: [+/-]amount"
+  if (input2 == "who" && !argv[3]) {
+    std::cerr << "Command 'who' expects another argument: [+/-]amount"
+    << std::endl;
+    return 1;
+  }
+
+  // Map the file (a snapshot, or a .dat parsed and sorted in chunks on
+  // @threads threads), build the treemap and apply the delta log on top
+  Treemap<int, std::string> donation;
+  bool snapshot = false;
+  size_t entries = 0;
+  size_t log_offset = 0;
+  try {
+    if (!LoadDonationIndex(argv[1], donation, threads, &snapshot)) {
+      std::cerr << "Error: cannot open file " << argv[1]
       << std::endl;
       return 1;
     }
-    std::string arg3 = argv[3];
-    if (arg3[0] == '+' || arg3[0] == '-') {
-      input3 = arg3[0];
-      arg3.erase(0, 1);
-    } else {
-      input3 = ' ';
+    if (log_path) {
+      entries = ApplyDeltaLog(donation, log_path, &log_offset);
     }
-    amount = stoi(arg3);
+  } catch (const std::exception &e) {
+    std::cerr << "Error: " << e.what() << std::endl;
+    return 1;
   }
 
-  // Check to see if file can be opened
-  std::ifstream list(argv[1]);
-  if (!list) {
-    std::cerr << "Error: cannot open file " << argv[1]
-    << std::endl;
-    return 1;
+  // Fold the log into a snapshot; the log is emptied only when the base
+  // file itself was rewritten, replaying it onto another snapshot is harmless
+  bool auto_compact = compact_after > 0 && log_path && snapshot;
+  if (input2 == "compact" || (auto_compact && entries >= compact_after)) {
+    const char *out = input2 == "compact" && argv[3] ? argv[3] :
+      (snapshot ? argv[1] : nullptr);
+    if (!out) {
+      std::cerr << "Command 'compact' expects a snapshot path for a .dat file"
+      << std::endl;
+      return 1;
+    }
+    bool ok;
+    try {
+      ok = log_path && std::string(out) == argv[1] ?
+        CompactDeltaLog(donation, log_path, out, &log_offset) :
+        WriteSnapshot(donation, out);
+    } catch (const std::exception &e) {
+      std::cerr << "Error: " << e.what() << std::endl;
+      return 1;
+    }
+    if (!ok) {
+      std::cerr << "Error: cannot write snapshot " << out << std::endl;
+      return 1;
+    }
+    entries = 0;
+    if (input2 == "compact") {
+      return 0;
+    }
   }
 
-  // Declares treemap
-  Treemap<int, std::string> donation;
-  std::vector<std::string> values;
-  std::string line;
-  // reads each line using getline, then cast to isstream
-  // and use getline to read in values split by comma
-  while (std::getline(list, line)) {
-    std::istringstream iss(line);
-    std::string token;
-    while (std::getline(iss, token, ',')) {
-      values.push_back(token);
+  // Answer a whole file of commands through one output buffer
+  if (queries_path) {
+    MappedFile queries;
+    if (!queries.Open(queries_path)) {
+      std::cerr << "Error: cannot open file " << queries_path << std::endl;
+      return 1;
     }
+    bool written = true;
+    size_t failed = AnswerQueryBatch(donation, queries.Data(),
+      queries.Data() + queries.Size(), sort_queries,
+      [&written](const std::string &out) {
+        written = WriteAll(1, out);
+        return written;
+      });
+    if (!written) {
+      std::cerr << "Error: cannot write output" << std::endl;
+      return 1;
+    }
+    return failed == 0 ? 0 : 1;
   }
-  // values into treemap
-  for (unsigned int i = 0; i < values.size(); i += 2) {
-    int amount = stoi(values[i + 1]);
-    donation.Insert(amount, values[i]);
+
+  // Keep the map loaded and answer commands from stdin or a socket; once a
+  // second, apply what was appended to the log and compact it when due
+  if (input2 == "serve") {
+    auto next_check = std::chrono::steady_clock::now();
+    auto tick = [&]() {
+      auto now = std::chrono::steady_clock::now();
+      if (!log_path || now < next_check) {
+        return;
+      }
+      next_check = now + std::chrono::seconds(1);
+      try {
+        entries += ApplyDeltaLog(donation, log_path, &log_offset);
+        if (auto_compact && entries >= compact_after) {
+          if (!CompactDeltaLog(donation, log_path, argv[1], &log_offset)) {
+            std::cerr << "Error: cannot compact log " << log_path
+            << std::endl;
+            return;
+          }
+          entries = 0;
+        }
+      } catch (const std::exception &e) {
+        // Stop following a log that cannot be applied
+        std::cerr << "Error: " << e.what() << std::endl;
+        log_path = nullptr;
+      }
+    };
+    if (socket_path) {
+      if (!ServeDonationsSocket(donation, socket_path, tick)) {
+        std::cerr << "Error: cannot serve on socket " << socket_path
+        << std::endl;
+        return 1;
+      }
+      return 0;
+    }
+    ServeDonations(donation, 0, 1, tick);
+    return 0;
   }
 
   // Perform actions based on command line arguments
-  if (input2 == "all") {
-    all(donation);
-  } else if (input2 == "rich") {
-    int max = donation.MaxKey();
-    std::cout << donation.Get(max) << " (" << max << ")" << std::endl;
-  } else if (input2 == "cheap") {
-    int min = donation.MinKey();
-    std::cout << donation.Get(min) << " (" << min << ")" << std::endl;
-  } else if (input2 == "who") {
-    int result = find(donation, amount, input3);
-    std::cout << donation.Get(result) << " (" << result << ")" << std::endl;
-  } else {
-    std::cerr << "Command" << " '" << input2 << "' " << "is invalid"
-      << std::endl;
-    std::cerr << "Possible commands are: all|cheap|rich|who" << std::endl;
-    return 1;
+  std::string command = input2;
+  for (int i = 3; argv[i]; i++) {
+    command += ' ';
+    command += argv[i];
   }
+  std::string out;
+  std::string error;
+  QueryStatus status = AnswerQuery(donation, command.data(),
+    command.data() + command.size(), out, error);
+  std::cout << out;
+  if (status == kQueryInvalid) {
+    std::cerr << error << std::endl;
+  }
+  return status == kQueryOk ? 0 : 1;
 }
-
@@ -0,0 +1,177 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+// Generate a donations file of "name,amount" lines on stdout
+//
+// Amounts are the Treemap keys, so they are always distinct:
+//   sorted   1, 2, ..., N
+//   reverse  N, ..., 2, 1
+//   random   1..N in a pseudo-random order
+//   zipf     gaps between consecutive amounts follow a Zipf law (mostly
+//            tight clusters, a few large jumps), in a pseudo-random order:
+//            blocks of 64Ki consecutive amounts in a scrambled order, each
+//            scrambled in turn, so memory stays bounded at any row count
+//   dup      like random, but names come from a small pool so many donors
+//            repeat (repeated amounts would be rejected at load)
+
+// Visit every index in [0, @n) once in a scrambled order: i -> (a*i + b) % n
+// with a coprime to n and close to n/phi, so neighbours land far apart
+struct Scramble {
+  unsigned long long n, a, b;
+  Scramble(unsigned long long rows, std::mt19937_64 &rng) : n(rows), a(1),
+    b(0) {
+    if (n > 1) {
+      a = static_cast<unsigned long long>(n * 0.6180339887498949) | 1;
+      while (Gcd(a, n) != 1) {
+        a += 2;
+      }
+      b = rng() % n;
+    }
+  }
+  static unsigned long long Gcd(unsigned long long x, unsigned long long y) {
+    while (y) {
+      unsigned long long t = x % y;
+      x = y;
+      y = t;
+    }
+    return x;
+  }
+  unsigned long long operator()(unsigned long long i) const {
+    return static_cast<unsigned long long>(
+      (static_cast<unsigned __int128>(a) * i + b) % n);
+  }
+};
+
+// Amounts whose gaps follow P(gap = k) ~ 1 / k^1.2 for k in 1..@cap, the
+// sorted amounts being their prefix sums. Every gap is a pure function of
+// the seed and its rank, so a block of amounts can be rebuilt on demand
+// from the amount before it; only those, one per block, are stored
+struct ZipfAmounts {
+  static const unsigned long long kBlock = 1 << 16;
+  std::vector<double> cdf;
+  unsigned long long seed;
+  // Amount before the first one of each block
+  std::vector<long long> base;
+
+  ZipfAmounts(unsigned long long rows, int cap, unsigned long long seed)
+    : seed(seed) {
+    double total = 0;
+    for (int k = 1; k <= cap; k++) {
+      total += 1.0 / std::pow(k, 1.2);
+      cdf.push_back(total);
+    }
+    long long sum = 0;
+    for (unsigned long long r = 0; r < rows; r++) {
+      if (r % kBlock == 0) {
+        base.push_back(sum);
+      }
+      sum += Gap(r);
+    }
+  }
+  // splitmix64 finalizer
+  static unsigned long long Mix(unsigned long long x) {
+    x += 0x9e3779b97f4a7c15ULL;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+    return x ^ (x >> 31);
+  }
+  int Gap(unsigned long long rank) const {
+    double u = (Mix(seed ^ Mix(rank)) >> 11) * (1.0 / (1ULL << 53));
+    size_t k = std::upper_bound(cdf.begin(), cdf.end(), u * cdf.back()) -
+      cdf.begin();
+    return static_cast<int>(std::min(k, cdf.size() - 1)) + 1;
+  }
+  // Fill @out with the sorted amounts of block @b, of @rows in all
+  void Fill(unsigned long long b, unsigned long long rows,
+    std::vector<int> &out) const {
+    unsigned long long first = b * kBlock;
+    unsigned long long last = std::min(rows, first + kBlock);
+    out.clear();
+    long long sum = base[b];
+    for (unsigned long long r = first; r < last; r++) {
+      sum += Gap(r);
+      out.push_back(static_cast<int>(sum));
+    }
+  }
+};
+
+const unsigned long long ZipfAmounts::kBlock;
+
+int main(int argc, char *argv[]) {
+  if (argc < 3) {
+    std::cerr << "Usage: ./gen_donations <rows>"
+    << " <sorted|reverse|random|zipf|dup> [seed]" << std::endl;
+    return 1;
+  }
+  long long rows = atoll(argv[1]);
+  std::string dist = argv[2];
+  std::mt19937_64 rng(argc > 3 ? strtoull(argv[3], nullptr, 10) : 42);
+  if (rows < 0 || rows > 2000000000LL) {
+    std::cerr << "Error: rows must be between 0 and 2000000000" << std::endl;
+    return 1;
+  }
+  if (dist != "sorted" && dist != "reverse" && dist != "random" &&
+    dist != "zipf" && dist != "dup") {
+    std::cerr << "Error: unknown distribution '" << dist << "'" << std::endl;
+    return 1;
+  }
+  unsigned long long n = rows;
+  Scramble scramble(n, rng);
+
+  // Zipf gaps of at most 64, fewer when needed to keep the sum within int
+  int cap = static_cast<int>(std::min<long long>(64,
+    std::max<long long>(1, 2000000000LL / std::max<long long>(rows, 1))));
+  std::unique_ptr<ZipfAmounts> zipf;
+  // The block being written, in @block_order, and the scramble within it
+  unsigned long long blocks = (n + ZipfAmounts::kBlock - 1) /
+    ZipfAmounts::kBlock;
+  Scramble block_order(blocks, rng);
+  unsigned long long block = 0, in_block = 0;
+  std::vector<int> amounts;
+  Scramble inside(0, rng);
+  if (dist == "zipf") {
+    zipf.reset(new ZipfAmounts(n, cap, rng()));
+  }
+
+  std::string out;
+  out.reserve(1 << 22);
+  for (unsigned long long i = 0; i < n; i++) {
+    unsigned long long amount;
+    unsigned long long donor = i;
+    if (dist == "sorted") {
+      amount = i + 1;
+    } else if (dist == "reverse") {
+      amount = n - i;
+    } else if (dist == "zipf") {
+      if (in_block == amounts.size()) {
+        zipf->Fill(block_order(block++), n, amounts);
+        inside = Scramble(amounts.size(), rng);
+        in_block = 0;
+      }
+      amount = amounts[inside(in_block++)];
+    } else {
+      amount = scramble(i) + 1;
+      if (dist == "dup") {
+        donor = amount % 97;
+      }
+    }
+    out += "Donor ";
+    out += std::to_string(donor);
+    out += ',';
+    out += std::to_string(amount);
+    out += '\n';
+    if (out.size() >= (1 << 22) - 64) {
+      fwrite(out.data(), 1, out.size(), stdout);
+      out.clear();
+    }
+  }
+  fwrite(out.data(), 1, out.size(), stdout);
+  return fflush(stdout) == 0 ? 0 : 1;
+}
@@ -0,0 +1,329 @@
+#ifndef SKIPLIST_H_
+#define SKIPLIST_H_
+
+#include <atomic>
+#include <cstdlib>
+#include <exception>
+#include <new>
+#include <random>
+#include <stdexcept>
+#include <utility>
+
+// Ordered map with the same API as Treemap, backed by a skip list.
+//
+// Insert and all lookups are lock-free and may run concurrently from any
+// number of threads: a new node is published with a CAS on level 0 and then
+// linked into the upper levels one at a time, so readers always see a
+// consistent list. Remove (and destruction) must not overlap any other
+// operation, since unlinked nodes are freed immediately.
+template <typename K, typename V>
+class Skiplist {
+ public:
+  Skiplist();
+  ~Skiplist();
+  Skiplist(const Skiplist &) = delete;
+  Skiplist &operator=(const Skiplist &) = delete;
+
+  // * Capacity
+  // Returns number of key-value mappings in map --O(1)
+  size_t Size();
+  // Returns true if map is empty --O(1)
+  bool Empty();
+
+  // * Modifiers
+  // Insert @key in map, safe to call concurrently --O(log N) expected
+  void Insert(const K &key, const V &value);
+  // Remove @key from map, requires exclusive access --O(log N) expected
+  void Remove(const K &key);
+
+  // * Lookup
+  // Return value corresponding to @key --O(log N) expected
+  const V& Get(const K &key);
+
+  // Return greatest key less than or equal to @key --O(log N) expected
+  const K& FloorKey(const K &key);
+  // Return least key greater than or equal to @key --O(log N) expected
+  const K& CeilKey(const K &key);
+
+  // Return whether @key is found in map --O(log N) expected
+  bool ContainsKey(const K& key);
+  // Return whether @value is found in map --O(N)
+  bool ContainsValue(const V& value);
+
+  // Return max key in map --O(log N) expected
+  const K& MaxKey();
+  // Return min key in map --O(1)
+  const K& MinKey();
+
+ private:
+    static const int kMaxLevel = 32;
+    // Tower of @level next pointers is stored inline right after the node
+    struct alignas(std::atomic<void*>) Node {
+      K key;
+      V value;
+      int level;
+      std::atomic<Node*> *next;
+      Node(const K &k, const V &v, int l) : key(k), value(v), level(l),
+        next(reinterpret_cast<std::atomic<Node*>*>(this + 1)) {
+        for (int i = 0; i < l; i++) {
+          new (&next[i]) std::atomic<Node*>(nullptr);
+        }
+      }
+      static Node* Create(const K &k, const V &v, int l) {
+        void *p = ::operator new(sizeof(Node) +
+          l * sizeof(std::atomic<Node*>));
+        try {
+          return new (p) Node(k, v, l);
+        } catch (...) {
+          ::operator delete(p);
+          throw;
+        }
+      }
+      static void Destroy(Node *n) {
+        if (n) {
+          n->~Node();
+          ::operator delete(n);
+        }
+      }
+    };
+    // Sentinel head only uses its next array, key and value stay default
+    struct Head {
+      std::atomic<Node*> next[kMaxLevel];
+    };
+    Head head;
+    // Highest level in use, searches start here instead of at kMaxLevel
+    std::atomic<int> levels;
+    std::atomic<size_t> size;
+    int RandomLevel();
+    std::atomic<Node*> &Next(Node *n, int level);
+    bool Find(const K &key, Node **preds, Node **succs);
+    Node* Lower(const K &key, Node **succ);
+    Node* CheckEmpty();
+};
+
+template <typename K, typename V>
+Skiplist<K, V>::Skiplist() : levels(1), size(0) {
+  for (int i = 0; i < kMaxLevel; i++) {
+    head.next[i].store(nullptr, std::memory_order_relaxed);
+  }
+}
+
+template <typename K, typename V>
+Skiplist<K, V>::~Skiplist() {
+  Node *n = head.next[0].load(std::memory_order_relaxed);
+  while (n) {
+    Node *next = n->next[0].load(std::memory_order_relaxed);
+    Node::Destroy(n);
+    n = next;
+  }
+}
+
+template <typename K, typename V>
+size_t Skiplist<K, V>::Size() {
+  return size.load(std::memory_order_relaxed);
+}
+
+template <typename K, typename V>
+bool Skiplist<K, V>::Empty() {
+  return Size() == 0;
+}
+
+// Geometric level with p = 1/2, one RNG per thread so inserts don't contend
+template <typename K, typename V>
+int Skiplist<K, V>::RandomLevel() {
+  static thread_local std::minstd_rand rng(std::random_device{}());
+  unsigned bits = static_cast<unsigned>(rng()) | (1u << (kMaxLevel - 2));
+  int level = 1;
+  while ((bits & 1) && level < kMaxLevel) {
+    bits >>= 1;
+    level++;
+  }
+  return level;
+}
+
+// Next pointer at @level of @n, where nullptr stands for the head sentinel
+template <typename K, typename V>
+std::atomic<typename Skiplist<K, V>::Node*> &Skiplist<K, V>::Next(Node *n,
+  int level) {
+  return n ? n->next[level] : head.next[level];
+}
+
+// Fill @preds/@succs with the nodes around @key at every level, return true
+// if a node with @key is already linked at level 0
+template <typename K, typename V>
+bool Skiplist<K, V>::Find(const K &key, Node **preds, Node **succs) {
+  Node *pred = nullptr;
+  for (int i = levels.load(std::memory_order_acquire) - 1; i >= 0; i--) {
+    Node *curr = Next(pred, i).load(std::memory_order_acquire);
+    while (curr && curr->key < key) {
+      pred = curr;
+      curr = curr->next[i].load(std::memory_order_acquire);
+    }
+    preds[i] = pred;
+    succs[i] = curr;
+  }
+  return succs[0] && succs[0]->key == key;
+}
+
+// Return the last node with key strictly less than @key, nullptr if none,
+// and set @succ to the level 0 node it was compared against, the first with
+// key not less than @key. Callers must use @succ rather than reload the
+// next pointer of the result: a concurrent insert may have linked a
+// smaller key in between since
+template <typename K, typename V>
+typename Skiplist<K, V>::Node* Skiplist<K, V>::Lower(const K &key,
+  Node **succ) {
+  Node *pred = nullptr;
+  Node *curr = nullptr;
+  for (int i = levels.load(std::memory_order_acquire) - 1; i >= 0; i--) {
+    curr = Next(pred, i).load(std::memory_order_acquire);
+    while (curr && curr->key < key) {
+      pred = curr;
+      curr = curr->next[i].load(std::memory_order_acquire);
+    }
+  }
+  *succ = curr;
+  return pred;
+}
+
+// Return the first node, throw if map is empty
+template <typename K, typename V>
+typename Skiplist<K, V>::Node* Skiplist<K, V>::CheckEmpty() {
+  Node *n = head.next[0].load(std::memory_order_acquire);
+  if (!n) {
+    throw std::out_of_range("Skiplist is empty");
+  }
+  return n;
+}
+
+template <typename K, typename V>
+void Skiplist<K, V>::Insert(const K &key, const V &value) {
+  Node *preds[kMaxLevel];
+  Node *succs[kMaxLevel];
+  Node *n = nullptr;
+  while (true) {
+    if (Find(key, preds, succs)) {
+      Node::Destroy(n);
+      throw std::invalid_argument("Node already exist");
+    }
+    if (!n) {
+      n = Node::Create(key, value, RandomLevel());
+      int top = levels.load(std::memory_order_relaxed);
+      while (top < n->level && !levels.compare_exchange_weak(top, n->level,
+        std::memory_order_relaxed)) {
+      }
+      // Search again so @preds covers every level of the new tower
+      continue;
+    }
+    n->next[0].store(succs[0], std::memory_order_relaxed);
+    // Level 0 decides membership, retry the search if someone got there first
+    if (Next(preds[0], 0).compare_exchange_strong(succs[0], n,
+      std::memory_order_release, std::memory_order_relaxed)) {
+      break;
+    }
+  }
+  for (int i = 1; i < n->level; i++) {
+    while (true) {
+      n->next[i].store(succs[i], std::memory_order_relaxed);
+      if (Next(preds[i], i).compare_exchange_strong(succs[i], n,
+        std::memory_order_release, std::memory_order_relaxed)) {
+        break;
+      }
+      Find(key, preds, succs);
+    }
+  }
+  size.fetch_add(1, std::memory_order_relaxed);
+}
+
+template <typename K, typename V>
+void Skiplist<K, V>::Remove(const K &key) {
+  Node *preds[kMaxLevel];
+  Node *succs[kMaxLevel];
+  if (!Find(key, preds, succs)) {
+    throw std::invalid_argument("key not found");
+  }
+  Node *n = succs[0];
+  for (int i = 0; i < n->level; i++) {
+    Next(preds[i], i).store(n->next[i].load(std::memory_order_relaxed),
+      std::memory_order_release);
+  }
+  Node::Destroy(n);
+  size.fetch_sub(1, std::memory_order_relaxed);
+}
+
+template <typename K, typename V>
+const V& Skiplist<K, V>::Get(const K &key) {
+  CheckEmpty();
+  Node *n;
+  Lower(key, &n);
+  if (!n || !(n->key == key)) {
+    throw std::invalid_argument("Node doesn't exist");
+  }
+  return n->value;
+}
+
+template <typename K, typename V>
+const K& Skiplist<K, V>::FloorKey(const K &key) {
+  CheckEmpty();
+  Node *n;
+  Node *pred = Lower(key, &n);
+  if (n && n->key == key) {
+    return n->key;
+  }
+  if (!pred) {
+    throw std::invalid_argument("No smaller key");
+  }
+  return pred->key;
+}
+
+template <typename K, typename V>
+const K& Skiplist<K, V>::CeilKey(const K &key) {
+  CheckEmpty();
+  Node *n;
+  Lower(key, &n);
+  if (!n) {
+    throw std::invalid_argument("No larger key");
+  }
+  return n->key;
+}
+
+template <typename K, typename V>
+bool Skiplist<K, V>::ContainsKey(const K& key) {
+  Node *n;
+  Lower(key, &n);
+  return n && n->key == key;
+}
+
+template <typename K, typename V>
+bool Skiplist<K, V>::ContainsValue(const V& value) {
+  Node *n = head.next[0].load(std::memory_order_acquire);
+  while (n) {
+    if (n->value == value) {
+      return true;
+    }
+    n = n->next[0].load(std::memory_order_acquire);
+  }
+  return false;
+}
+
+// Walk right as far as possible on each level, top down
+template <typename K, typename V>
+const K& Skiplist<K, V>::MaxKey() {
+  CheckEmpty();
+  Node *pred = nullptr;
+  for (int i = levels.load(std::memory_order_acquire) - 1; i >= 0; i--) {
+    Node *curr = Next(pred, i).load(std::memory_order_acquire);
+    while (curr) {
+      pred = curr;
+      curr = curr->next[i].load(std::memory_order_acquire);
+    }
+  }
+  return pred->key;
+}
+
+template <typename K, typename V>
+const K& Skiplist<K, V>::MinKey() {
+  return CheckEmpty()->key;
+}
+
+#endif  // SKIPLIST_H_
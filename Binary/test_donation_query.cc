@@ -0,0 +1,44 @@
+#include <gtest/gtest.h>
+#include <string>
+#include "donation_query.h"
+#include "treemap.h"
+
+TEST(DonationQuery, ParseWho) {
+  const std::string args[] = {"+20", "  +20", "\t-20 ", "20", " 20"};
+  const char choices[] = {'+', '+', '-', ' ', ' '};
+  for (int i = 0; i < 5; i++) {
+    char choice;
+    int amount;
+    ParseWho(args[i].data(), args[i].data() + args[i].size(), &choice,
+      &amount);
+    EXPECT_EQ(choice, choices[i]);
+    EXPECT_EQ(amount, 20);
+  }
+  char choice;
+  int amount;
+  std::string bad = "  +";
+  EXPECT_THROW(ParseWho(bad.data(), bad.data() + bad.size(), &choice,
+    &amount), std::invalid_argument);
+}
+
+TEST(DonationQuery, WhoWithExtraBlanks) {
+  Treemap<int, std::string> donation;
+  donation.Insert(10, "A");
+  donation.Insert(20, "B");
+  donation.Insert(30, "C");
+  const std::string commands[] = {"who +20", "who  +20", "who  -20",
+    "who  20"};
+  const char *replies[] = {"C (30)\n", "C (30)\n", "A (10)\n", "B (20)\n"};
+  for (int i = 0; i < 4; i++) {
+    std::string out;
+    std::string error;
+    EXPECT_EQ(AnswerQuery(donation, commands[i].data(),
+      commands[i].data() + commands[i].size(), out, error), kQueryOk);
+    EXPECT_EQ(out, replies[i]);
+  }
+}
+
+int main(int argc, char *argv[]) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,232 @@
+#include <gtest/gtest.h>
+#include <atomic>
+#include <random>
+#include <thread>
+#include <vector>
+#include "skiplist.h"
+
+TEST(Skiplist, Empty) {
+  Skiplist<int, int> map;
+
+  /* Should be fully empty */
+  EXPECT_EQ(map.Empty(), true);
+  EXPECT_EQ(map.Size(), 0);
+  EXPECT_THROW(map.Get(42), std::exception);
+  EXPECT_EQ(map.ContainsKey(30), false);
+  EXPECT_EQ(map.ContainsValue(1), false);
+  EXPECT_THROW(map.MaxKey(), std::exception);
+  EXPECT_THROW(map.MinKey(), std::exception);
+  EXPECT_THROW(map.CeilKey(31), std::exception);
+  EXPECT_THROW(map.FloorKey(56), std::exception);
+}
+
+TEST(Skiplist, InsertGet) {
+  Skiplist<int, char> map;
+  map.Insert(23, 'A');
+  map.Insert(42, 'B');
+  map.Insert(37, 'C');
+  map.Insert(10, 'D');
+  EXPECT_EQ(map.Empty(), false);
+  EXPECT_EQ(map.Size(), 4);
+  EXPECT_EQ(map.MinKey(), 10);
+  EXPECT_EQ(map.MaxKey(), 42);
+  EXPECT_EQ(map.Get(23), 'A');
+  EXPECT_EQ(map.Get(37), 'C');
+  EXPECT_EQ(map.ContainsKey(42), true);
+  EXPECT_EQ(map.ContainsKey(32), false);
+  EXPECT_EQ(map.ContainsValue('D'), true);
+  EXPECT_EQ(map.ContainsValue('Z'), false);
+  EXPECT_THROW(map.Get(30), std::exception);
+  // Duplicate key throws like Treemap
+  EXPECT_THROW(map.Insert(23, 'E'), std::exception);
+  EXPECT_EQ(map.Size(), 4);
+}
+
+TEST(Skiplist, Remove) {
+  Skiplist<int, char> map;
+  map.Insert(23, 'A');
+  map.Insert(42, 'B');
+  map.Insert(11, 'C');
+  map.Remove(23);
+  EXPECT_EQ(map.Size(), 2);
+  EXPECT_EQ(map.ContainsKey(23), false);
+  EXPECT_EQ(map.ContainsValue('A'), false);
+  EXPECT_EQ(map.MinKey(), 11);
+  map.Remove(11);
+  map.Remove(42);
+  EXPECT_EQ(map.Empty(), true);
+  EXPECT_THROW(map.Remove(9), std::exception);
+  EXPECT_THROW(map.MinKey(), std::exception);
+  map.Insert(30, 'C');
+  EXPECT_EQ(map.MaxKey(), 30);
+  EXPECT_EQ(map.MinKey(), 30);
+}
+
+TEST(Skiplist, FloorKey) {
+  Skiplist<int, char> map;
+  map.Insert(119, 'A');
+  map.Insert(100, 'B');
+  map.Insert(130, 'C');
+  map.Insert(125, 'D');
+  map.Insert(140, 'E');
+  map.Insert(135, 'F');
+  map.Insert(128, 'G');
+  EXPECT_EQ(map.FloorKey(137), 135);
+  EXPECT_EQ(map.FloorKey(120), 119);
+  EXPECT_EQ(map.FloorKey(129), 128);
+  EXPECT_EQ(map.FloorKey(127), 125);
+  EXPECT_EQ(map.FloorKey(140), 140);
+  EXPECT_EQ(map.FloorKey(141), 140);
+  EXPECT_EQ(map.FloorKey(101), 100);
+  EXPECT_THROW(map.FloorKey(10), std::exception);
+}
+
+TEST(Skiplist, CeilKey) {
+  Skiplist<int, char> map;
+  map.Insert(119, 'A');
+  map.Insert(100, 'B');
+  map.Insert(130, 'C');
+  map.Insert(125, 'D');
+  map.Insert(140, 'E');
+  map.Insert(135, 'F');
+  map.Insert(128, 'G');
+  EXPECT_EQ(map.CeilKey(132), 135);
+  EXPECT_EQ(map.CeilKey(115), 119);
+  EXPECT_EQ(map.CeilKey(126), 128);
+  EXPECT_EQ(map.CeilKey(124), 125);
+  EXPECT_EQ(map.CeilKey(137), 140);
+  EXPECT_EQ(map.CeilKey(140), 140);
+  EXPECT_EQ(map.CeilKey(90), 100);
+  EXPECT_THROW(map.CeilKey(200), std::exception);
+}
+
+TEST(Skiplist, ConcurrentInsert) {
+  // Interleaved key ranges from several threads, then check
+  // every key landed exactly once and in order
+  Skiplist<int, int> map;
+  const int threads = 4;
+  const int per_thread = 5000;
+  std::vector<std::thread> workers;
+  for (int t = 0; t < threads; t++) {
+    workers.emplace_back([&map, t]() {
+      for (int i = 0; i < per_thread; i++) {
+        int key = i * threads + t;
+        map.Insert(key, -key);
+        EXPECT_EQ(map.Get(key), -key);
+      }
+    });
+  }
+  for (auto &w : workers) {
+    w.join();
+  }
+  EXPECT_EQ(map.Size(), threads * per_thread);
+  EXPECT_EQ(map.MinKey(), 0);
+  EXPECT_EQ(map.MaxKey(), threads * per_thread - 1);
+  for (int key = 0; key < threads * per_thread; key++) {
+    EXPECT_EQ(map.CeilKey(key), key);
+  }
+}
+
+TEST(Skiplist, ConcurrentDuplicateInsert) {
+  // Only one of the racing inserts of the same key may win
+  Skiplist<int, int> map;
+  std::atomic<int> wins(0);
+  std::vector<std::thread> workers;
+  for (int t = 0; t < 4; t++) {
+    workers.emplace_back([&map, &wins]() {
+      for (int key = 0; key < 1000; key++) {
+        try {
+          map.Insert(key, key);
+          wins++;
+        } catch (const std::invalid_argument &) {
+        }
+      }
+    });
+  }
+  for (auto &w : workers) {
+    w.join();
+  }
+  EXPECT_EQ(wins.load(), 1000);
+  EXPECT_EQ(map.Size(), 1000);
+}
+
+TEST(Skiplist, ConcurrentLookups) {
+  // Readers race the writers of even keys; a key whose insert returned
+  // before a lookup started must be seen by it, and odd keys never exist
+  Skiplist<int, int> map;
+  const int writers = 2;
+  const int keys = 20000;
+  const int window = 16;
+  std::vector<std::atomic<bool>> inserted(keys);
+  for (auto &f : inserted) {
+    f.store(false);
+  }
+  std::atomic<int> writing(writers);
+  std::atomic<int> missed(0), wrong(0);
+  std::vector<std::thread> workers;
+  for (int t = 0; t < writers; t++) {
+    workers.emplace_back([&, t]() {
+      for (int i = t; i < keys; i += writers) {
+        map.Insert(2 * i, i);
+        inserted[i].store(true, std::memory_order_release);
+      }
+      writing--;
+    });
+  }
+  for (int t = 0; t < 2; t++) {
+    workers.emplace_back([&, t]() {
+      std::minstd_rand rng(t + 1);
+      bool before[2 * window + 1];
+      while (writing > 0) {
+        // Odd @q, between the even keys 2 * (i - 1) and 2 * i
+        int i = 1 + rng() % (keys - 1);
+        int q = 2 * i - 1;
+        for (int d = -window; d <= window; d++) {
+          int j = i + d;
+          before[d + window] = j >= 0 && j < keys &&
+            inserted[j].load(std::memory_order_acquire);
+        }
+        if (before[window] && (!map.ContainsKey(2 * i) ||
+          map.Get(2 * i) != i)) {
+          missed++;
+        }
+        if (map.ContainsKey(q)) {
+          wrong++;
+        }
+        try {
+          int ceil = map.CeilKey(q);
+          if (ceil < q || ceil % 2) {
+            wrong++;
+          }
+          for (int d = 0; d <= window && 2 * (i + d) < ceil; d++) {
+            missed += before[window + d];
+          }
+        } catch (const std::exception &) {
+          missed += before[window];
+        }
+        try {
+          int floor = map.FloorKey(q);
+          if (floor > q || floor % 2) {
+            wrong++;
+          }
+          for (int d = 1; d <= window && 2 * (i - d) > floor; d++) {
+            missed += before[window - d];
+          }
+        } catch (const std::exception &) {
+          missed += before[window - 1];
+        }
+      }
+    });
+  }
+  for (auto &w : workers) {
+    w.join();
+  }
+  EXPECT_EQ(missed.load(), 0);
+  EXPECT_EQ(wrong.load(), 0);
+  EXPECT_EQ(map.Size(), keys);
+}
+
+int main(int argc, char *argv[]) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
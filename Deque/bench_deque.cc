@@ -0,0 +1,269 @@
+#include <benchmark/benchmark.h>
+#include <algorithm>
+#include <chrono>
+#include <deque>
+#include <memory_resource>
+#include <vector>
+#include "block_deque.h"
+#include "deque.h"
+
+// Microbenchmarks of Deque and BlockDeque against std::deque
+//
+// StdDeque wraps std::deque behind Deque's API so every benchmark is one
+// template over both.
+
+template <typename T>
+class StdDeque {
+ public:
+  bool Empty() const noexcept { return dq.empty(); }
+  size_t Size() const noexcept { return dq.size(); }
+  T& operator[](size_t pos) { return dq[pos]; }
+  T& Front() { return dq.front(); }
+  T& Back() { return dq.back(); }
+  void Clear() noexcept { dq.clear(); }
+  void PushFront(const T &value) { dq.push_front(value); }
+  void PushBack(const T &value) { dq.push_back(value); }
+  void PopFront() { dq.pop_front(); }
+  void PopBack() { dq.pop_back(); }
+
+ private:
+    std::deque<T> dq;
+};
+
+// Fill an empty deque with range(0) items at the back, then drain it
+template <typename D>
+static void BM_PushBackPopFront(benchmark::State &state) {
+  const int n = state.range(0);
+  for (auto _ : state) {
+    D dq;
+    for (int i = 0; i < n; i++) {
+      dq.PushBack(i);
+    }
+    while (!dq.Empty()) {
+      dq.PopFront();
+    }
+    benchmark::ClobberMemory();
+  }
+  state.SetItemsProcessed(state.iterations() * n);
+}
+
+template <typename D>
+static void BM_PushFront(benchmark::State &state) {
+  const int n = state.range(0);
+  for (auto _ : state) {
+    D dq;
+    for (int i = 0; i < n; i++) {
+      dq.PushFront(i);
+    }
+    benchmark::DoNotOptimize(dq.Back());
+  }
+  state.SetItemsProcessed(state.iterations() * n);
+}
+
+// Steady-state FIFO of range(0) items, so head and tail keep wrapping
+template <typename D>
+static void BM_RingQueue(benchmark::State &state) {
+  D dq;
+  for (int i = 0; i < state.range(0); i++) {
+    dq.PushBack(i);
+  }
+  int i = 0;
+  for (auto _ : state) {
+    dq.PushBack(i++);
+    benchmark::DoNotOptimize(dq.Front());
+    dq.PopFront();
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+
+// Sum every item through operator[] on a wrapped deque
+template <typename D>
+static void BM_IndexScan(benchmark::State &state) {
+  const int n = state.range(0);
+  D dq;
+  for (int i = 0; i < n; i++) {
+    if (i % 2) {
+      dq.PushBack(i);
+    } else {
+      dq.PushFront(i);
+    }
+  }
+  for (auto _ : state) {
+    long long sum = 0;
+    for (int i = 0; i < n; i++) {
+      sum += dq[i];
+    }
+    benchmark::DoNotOptimize(sum);
+  }
+  state.SetItemsProcessed(state.iterations() * n);
+}
+
+// Time each of range(0) pushes at the back on its own and report the
+// median, p99 and worst push; Deque's doublings show up in the tail
+template <typename D>
+static void BM_PushLatency(benchmark::State &state) {
+  const int n = state.range(0);
+  std::vector<long long> ns(n);
+  for (auto _ : state) {
+    D *dq = new D;
+    for (int i = 0; i < n; i++) {
+      auto start = std::chrono::steady_clock::now();
+      dq->PushBack(i);
+      ns[i] = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - start).count();
+    }
+    state.PauseTiming();
+    delete dq;
+    state.ResumeTiming();
+  }
+  std::sort(ns.begin(), ns.end());
+  state.counters["p50_ns"] = ns[n / 2];
+  state.counters["p99_ns"] = ns[n / 100 * 99];
+  state.counters["max_ns"] = ns[n - 1];
+}
+
+// Move range(0) items from one deque to another in batches of range(1),
+// item by item or with the range operations
+static void BM_BatchLoop(benchmark::State &state) {
+  const int n = state.range(0);
+  const int batch = state.range(1);
+  Deque<int> a, b;
+  Deque<int> *from = &a, *to = &b;
+  for (int i = 0; i < n; i++) {
+    from->PushBack(i);
+  }
+  for (auto _ : state) {
+    for (int moved = 0; moved < n; moved += batch) {
+      for (int i = 0; i < batch; i++) {
+        to->PushBack(from->Front());
+        from->PopFront();
+      }
+    }
+    std::swap(from, to);
+  }
+  state.SetItemsProcessed(state.iterations() * n);
+}
+
+static void BM_BatchRange(benchmark::State &state) {
+  const int n = state.range(0);
+  const int batch = state.range(1);
+  Deque<int> a, b;
+  Deque<int> *from = &a, *to = &b;
+  std::vector<int> buffer(batch);
+  for (int i = 0; i < n; i++) {
+    from->PushBack(i);
+  }
+  for (auto _ : state) {
+    for (int moved = 0; moved < n; moved += batch) {
+      from->PopFrontInto(buffer.data(), batch);
+      to->PushBackRange(buffer.data(), batch);
+    }
+    std::swap(from, to);
+  }
+  state.SetItemsProcessed(state.iterations() * n);
+}
+
+// The same scan through iterators and through Segments() pointers
+static void BM_IteratorScan(benchmark::State &state) {
+  const int n = state.range(0);
+  Deque<int> dq;
+  for (int i = 0; i < n; i++) {
+    dq.PushFront(i);
+  }
+  for (auto _ : state) {
+    long long sum = 0;
+    for (int value : dq) {
+      sum += value;
+    }
+    benchmark::DoNotOptimize(sum);
+  }
+  state.SetItemsProcessed(state.iterations() * n);
+}
+
+static void BM_SegmentScan(benchmark::State &state) {
+  const int n = state.range(0);
+  Deque<int> dq;
+  for (int i = 0; i < n; i++) {
+    dq.PushFront(i);
+  }
+  for (auto _ : state) {
+    auto spans = dq.Segments();
+    long long sum = 0;
+    for (int value : spans.first) {
+      sum += value;
+    }
+    for (int value : spans.second) {
+      sum += value;
+    }
+    benchmark::DoNotOptimize(sum);
+  }
+  state.SetItemsProcessed(state.iterations() * n);
+}
+
+// Build and drop 16 short-lived deques of range(0) items each, as a parser
+// or a per-request task would, so every growth is a malloc and a free
+// (until a SmallDeque outgrows its inline buffer, there are none)
+template <typename D>
+static void BM_Churn(benchmark::State &state) {
+  const int n = state.range(0);
+  for (auto _ : state) {
+    for (int k = 0; k < 16; k++) {
+      D dq;
+      for (int i = 0; i < n; i++) {
+        dq.PushBack(i);
+      }
+      benchmark::DoNotOptimize(dq.Back());
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * 16 * n);
+}
+
+// The same churn with the deques in an arena over one reused buffer: each
+// growth is a pointer bump, frees are no-ops and release() drops them all
+static void BM_ChurnArena(benchmark::State &state) {
+  const int n = state.range(0);
+  // Growing to 2n items takes under 4n items in total per deque
+  std::vector<char> buffer(16 * 4 * n * sizeof(int) + 4096);
+  std::pmr::monotonic_buffer_resource arena(buffer.data(), buffer.size());
+  for (auto _ : state) {
+    for (int k = 0; k < 16; k++) {
+      pmr::Deque<int> dq(&arena);
+      for (int i = 0; i < n; i++) {
+        dq.PushBack(i);
+      }
+      benchmark::DoNotOptimize(dq.Back());
+    }
+    arena.release();
+  }
+  state.SetItemsProcessed(state.iterations() * 16 * n);
+}
+
+#define BENCH_DEQUES(name) \
+  BENCHMARK_TEMPLATE(name, Deque<int>)->RangeMultiplier(16) \
+    ->Range(16, 1 << 20); \
+  BENCHMARK_TEMPLATE(name, BlockDeque<int>)->RangeMultiplier(16) \
+    ->Range(16, 1 << 20); \
+  BENCHMARK_TEMPLATE(name, StdDeque<int>)->RangeMultiplier(16) \
+    ->Range(16, 1 << 20)
+
+BENCH_DEQUES(BM_PushBackPopFront);
+BENCH_DEQUES(BM_PushFront);
+BENCH_DEQUES(BM_RingQueue);
+BENCH_DEQUES(BM_IndexScan);
+BENCHMARK_TEMPLATE(BM_PushLatency, Deque<int>)->Arg(1 << 20)->Arg(1 << 24)
+  ->Iterations(3)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_PushLatency, BlockDeque<int>)->Arg(1 << 20)
+  ->Arg(1 << 24)->Iterations(3)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_PushLatency, StdDeque<int>)->Arg(1 << 20)->Arg(1 << 24)
+  ->Iterations(3)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_BatchLoop)->Args({1 << 16, 64})->Args({1 << 16, 4096});
+BENCHMARK(BM_BatchRange)->Args({1 << 16, 64})->Args({1 << 16, 4096});
+BENCHMARK(BM_IteratorScan)->RangeMultiplier(16)->Range(16, 1 << 20);
+BENCHMARK(BM_SegmentScan)->RangeMultiplier(16)->Range(16, 1 << 20);
+BENCHMARK_TEMPLATE(BM_Churn, Deque<int>)->RangeMultiplier(4)
+  ->Range(4, 4096);
+BENCHMARK_TEMPLATE(BM_Churn, SmallDeque<int, 16>)->RangeMultiplier(4)
+  ->Range(4, 4096);
+BENCHMARK(BM_ChurnArena)->RangeMultiplier(4)->Range(4, 4096);
+
+BENCHMARK_MAIN();
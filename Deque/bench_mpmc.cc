@@ -0,0 +1,98 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "deque.h"
+#include "mpmc_queue.h"
+
+// Contention benchmark: half the threads push, half pop, through one
+// MpmcQueue or one Deque behind a global mutex (the setup it replaces);
+// thread counts go 2, 4, ... up to max_threads, one producer and one
+// consumer at the least
+//
+// Usage: ./bench_mpmc [messages] [max_threads] [capacity]
+
+// Start @producers threads running @produce(count) and @consumers running
+// @consume(count), splitting @n messages evenly; return elapsed seconds
+template <typename P, typename C>
+static double Run(int producers, int consumers, int n, P produce,
+  C consume) {
+  auto start = std::chrono::steady_clock::now();
+  std::vector<std::thread> threads;
+  for (int t = 0; t < producers; t++) {
+    threads.emplace_back(produce, n / producers + (t < n % producers));
+  }
+  for (int t = 0; t < consumers; t++) {
+    threads.emplace_back(consume, n / consumers + (t < n % consumers));
+  }
+  for (auto &t : threads) {
+    t.join();
+  }
+  std::chrono::duration<double> d = std::chrono::steady_clock::now() - start;
+  return d.count();
+}
+
+int main(int argc, char *argv[]) {
+  int n = argc > 1 ? atoi(argv[1]) : 1000000;
+  int max_threads = argc > 2 ? atoi(argv[2]) : 64;
+  int capacity = argc > 3 ? atoi(argv[3]) : 1024;
+  if (n <= 0 || max_threads <= 0 || capacity <= 0) {
+    std::fprintf(stderr,
+      "Usage: ./bench_mpmc [messages] [max_threads] [capacity]\n");
+    return 1;
+  }
+  std::printf("%u CPUs\n", std::thread::hardware_concurrency());
+  std::printf("%8s %16s %16s\n", "threads", "mutex Mmsg/s", "mpmc Mmsg/s");
+  for (int threads = 2; threads <= std::max(2, max_threads); threads *= 2) {
+    int producers = threads / 2;
+    int consumers = threads - producers;
+    double locked;
+    {
+      Deque<int> dq;
+      std::mutex lock;
+      locked = Run(producers, consumers, n, [&](int count) {
+        for (int i = 0; i < count;) {
+          {
+            std::lock_guard<std::mutex> guard(lock);
+            if (dq.Size() < static_cast<size_t>(capacity)) {
+              dq.PushBack(i++);
+              continue;
+            }
+          }
+          std::this_thread::yield();
+        }
+      }, [&](int count) {
+        for (int i = 0; i < count;) {
+          {
+            std::lock_guard<std::mutex> guard(lock);
+            if (!dq.Empty()) {
+              dq.PopFront();
+              i++;
+              continue;
+            }
+          }
+          std::this_thread::yield();
+        }
+      });
+    }
+    double lock_free;
+    {
+      MpmcQueue<int> q(capacity);
+      lock_free = Run(producers, consumers, n, [&](int count) {
+        for (int i = 0; i < count; i++) {
+          q.Push(i);
+        }
+      }, [&](int count) {
+        for (int i = 0; i < count; i++) {
+          q.Pop();
+        }
+      });
+    }
+    std::printf("%8d %16.2f %16.2f\n", producers + consumers,
+      n / locked / 1e6, n / lock_free / 1e6);
+  }
+  return 0;
+}
@@ -0,0 +1,95 @@
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <set>
+#include <vector>
+#include "sliding_window.h"
+
+// Rolling minimum of a stream of samples over windows of several sizes:
+// the std::multiset baseline (O(log W) per sample) against SlidingMin and
+// SlidingAggregate (amortized O(1)); SlidingAggregate also runs a gcd,
+// which has no monotonic-deque form. Reports nanoseconds per sample.
+//
+// Usage: ./bench_sliding_window [samples]
+
+typedef std::chrono::steady_clock Clock;
+
+struct Min {
+  unsigned int operator()(unsigned int a, unsigned int b) const {
+    return a < b ? a : b;
+  }
+};
+
+struct Gcd {
+  unsigned int operator()(unsigned int a, unsigned int b) const {
+    while (b) {
+      unsigned int t = a % b;
+      a = b;
+      b = t;
+    }
+    return a;
+  }
+};
+
+// Run @step(sample) on @n pseudo-random samples, each drawn when needed so
+// the stream needs no memory, and print the time per sample; the xor of
+// what @step returns keeps the work from being optimized away
+template <typename Step>
+static void Run(const char *name, size_t window, long long n, Step step) {
+  std::minstd_rand rng(1);
+  unsigned int check = 0;
+  auto start = Clock::now();
+  for (long long i = 0; i < n; i++) {
+    check ^= step(static_cast<unsigned int>(rng()));
+  }
+  std::chrono::duration<double> d = Clock::now() - start;
+  std::printf("%-20s %8zu %10.2f   (%08x)\n", name, window,
+    d.count() * 1e9 / n, check);
+}
+
+int main(int argc, char *argv[]) {
+  long long n = argc > 1 ? atoll(argv[1]) : 100000000;
+  if (n <= 0) {
+    std::fprintf(stderr, "Usage: ./bench_sliding_window [samples]\n");
+    return 1;
+  }
+  std::printf("%-20s %8s %10s\n", "", "window", "ns/sample");
+  for (size_t window : {16, 1024, 65536}) {
+    {
+      std::multiset<unsigned int> set;
+      std::vector<unsigned int> ring(window);
+      long long i = 0;
+      Run("std::multiset", window, n, [&](unsigned int x) {
+        if (i >= static_cast<long long>(window)) {
+          set.erase(set.find(ring[i % window]));
+        }
+        ring[i++ % window] = x;
+        set.insert(x);
+        return *set.begin();
+      });
+    }
+    {
+      SlidingMin<unsigned int> lo(window);
+      Run("SlidingMin", window, n, [&](unsigned int x) {
+        lo.Push(x);
+        return lo.Best();
+      });
+    }
+    {
+      SlidingAggregate<unsigned int, Min> lo(window);
+      Run("SlidingAggregate", window, n, [&](unsigned int x) {
+        lo.Push(x);
+        return lo.Query();
+      });
+    }
+    {
+      SlidingAggregate<unsigned int, Gcd> gcd(window);
+      Run("SlidingAggregate gcd", window, n, [&](unsigned int x) {
+        gcd.Push(x % 4096 * 6);
+        return gcd.Query();
+      });
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,140 @@
+#include <pthread.h>
+#include <sched.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "deque.h"
+#include "spsc_queue.h"
+
+// Hand timestamps from one thread to another through SpscQueue (one at a
+// time and in batches) and through a mutex-guarded Deque, reporting
+// messages per second and the one-way latency of each message
+//
+// Usage: ./bench_spsc [messages] [capacity]
+
+typedef std::chrono::steady_clock Clock;
+
+const int kBatch = 32;
+
+// Pin the calling thread to @cpu modulo the CPUs available, if allowed
+static void Pin(int cpu) {
+  int cpus = std::max(1u, std::thread::hardware_concurrency());
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  CPU_SET(cpu % cpus, &set);
+  pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+}
+
+static long long Nanos() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+    Clock::now().time_since_epoch()).count();
+}
+
+// Send @n timestamps from a producer pinned to CPU 0 to this thread pinned
+// to CPU 1; @send(stamps, count) must queue all @count stamps and
+// @receive(stamps, max) returns how many (at most @max) it dequeued
+template <typename Send, typename Receive>
+static void Run(const char *name, int n, int batch, Send send,
+  Receive receive) {
+  std::vector<long long> latency(n);
+  auto start = Clock::now();
+  std::thread producer([n, batch, &send]() {
+    Pin(0);
+    long long stamps[kBatch];
+    for (int i = 0; i < n; i += batch) {
+      int count = std::min(batch, n - i);
+      long long now = Nanos();
+      for (int j = 0; j < count; j++) {
+        stamps[j] = now;
+      }
+      send(stamps, count);
+    }
+  });
+  Pin(1);
+  long long stamps[kBatch];
+  for (int i = 0; i < n;) {
+    int count = receive(stamps, std::min(kBatch, n - i));
+    long long now = Nanos();
+    for (int j = 0; j < count; j++) {
+      latency[i++] = now - stamps[j];
+    }
+  }
+  std::chrono::duration<double> d = Clock::now() - start;
+  producer.join();
+  std::sort(latency.begin(), latency.end());
+  std::printf("%-14s %10.2f %10lld %10lld\n", name, n / d.count() / 1e6,
+    latency[n / 2], latency[n / 100 * 99]);
+}
+
+int main(int argc, char *argv[]) {
+  int n = argc > 1 ? atoi(argv[1]) : 2000000;
+  int capacity = argc > 2 ? atoi(argv[2]) : 1024;
+  if (n <= 0 || capacity <= 0) {
+    std::fprintf(stderr, "Usage: ./bench_spsc [messages] [capacity]\n");
+    return 1;
+  }
+  if (std::thread::hardware_concurrency() < 2) {
+    std::printf("Only one CPU: both threads share it, latency includes "
+      "scheduling\n");
+  }
+  std::printf("%-14s %10s %10s %10s\n", "queue", "Mmsg/s", "p50 ns",
+    "p99 ns");
+
+  {
+    Deque<long long> dq;
+    std::mutex lock;
+    Run("mutex+Deque", n, 1, [&](const long long *stamps, int count) {
+      for (int j = 0; j < count;) {
+        bool full;
+        {
+          std::lock_guard<std::mutex> guard(lock);
+          full = dq.Size() >= static_cast<size_t>(capacity);
+          if (!full) {
+            dq.PushBack(stamps[j++]);
+          }
+        }
+        if (full) {
+          std::this_thread::yield();
+        }
+      }
+    }, [&](long long *stamps, int) {
+      bool got;
+      {
+        std::lock_guard<std::mutex> guard(lock);
+        got = !dq.Empty();
+        if (got) {
+          *stamps = dq.TakeFront();
+        }
+      }
+      if (!got) {
+        std::this_thread::yield();
+      }
+      return got ? 1 : 0;
+    });
+  }
+  for (int batch : {1, kBatch}) {
+    SpscQueue<long long> q(capacity);
+    Run(batch == 1 ? "spsc" : "spsc batch", n, batch,
+      [&](const long long *stamps, int count) {
+        while (count > 0) {
+          size_t sent = q.PushBatch(stamps, count);
+          stamps += sent;
+          count -= sent;
+          if (sent == 0) {
+            std::this_thread::yield();
+          }
+        }
+      }, [&](long long *stamps, int max) {
+        size_t got = batch == 1 ? q.TryPop(*stamps) : q.PopBatch(stamps, max);
+        if (got == 0) {
+          std::this_thread::yield();
+        }
+        return static_cast<int>(got);
+      });
+  }
+  return 0;
+}
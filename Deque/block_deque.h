@@ -0,0 +1,390 @@
+#ifndef BLOCK_DEQUE_H_
+#define BLOCK_DEQUE_H_
+
+#include <cstddef>
+#include <new>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+// Items per block: the smallest power of two, at least 16, that fills
+// @bytes bytes of items of @size bytes
+constexpr size_t BlockDequeItems(size_t size, size_t bytes, size_t n = 16) {
+  return n * size >= bytes ? n : BlockDequeItems(size, bytes, n * 2);
+}
+
+constexpr size_t BlockDequeShift(size_t n) {
+  return n <= 1 ? 0 : 1 + BlockDequeShift(n / 2);
+}
+
+// Deque of fixed-size blocks with the same API as Deque. Items never move
+// once pushed, so references and pointers to them stay valid until they
+// are popped, and a push never copies items: it constructs one item and at
+// most takes a block, which is recycled from earlier pops when possible.
+// The map of block pointers still doubles when full, copying N / kBlockSize
+// pointers, which is what keeps indexing O(1)
+template<typename T>
+class BlockDeque {
+ public:
+  // Items in one block
+  static const size_t kBlockSize = BlockDequeItems(sizeof(T), 4096);
+  // Emptied blocks kept for reuse
+  static const size_t kSpareBlocks = 4;
+
+  // Constructor
+  BlockDeque();
+  // Destructor
+  ~BlockDeque();
+
+
+  //
+  // Capacity
+  //
+
+  // Return true if empty, false otherwise
+  // Complexity: O(1)
+  bool Empty() const noexcept;
+  // Return number of items in deque
+  // Complexity: O(1)
+  size_t Size() const noexcept;
+  // Free spare blocks and shrink the block map to the blocks in use
+  // Complexity: O(N / kBlockSize)
+  void ShrinkToFit();
+
+
+  //
+  // Element access
+  //
+
+  // Return item at pos @pos
+  // Complexity: O(1)
+  T& operator[](size_t pos);
+  // Return item at front of deque
+  // Complexity: O(1)
+  T& Front();
+  // Return item at back of deque
+  // Complexity: O(1)
+  T& Back();
+
+
+  //
+  // Modifiers
+  //
+
+  // Clear contents of deque (make it empty)
+  // Complexity: O(N)
+  void Clear(void) noexcept;
+  // Push item @value at front of deque
+  // Complexity: O(1), plus O(N / kBlockSize) when the map grows
+  void PushFront(const T &value);
+  void PushFront(T &&value);
+  // Push item @value at back of deque
+  // Complexity: O(1), plus O(N / kBlockSize) when the map grows
+  void PushBack(const T &value);
+  void PushBack(T &&value);
+  // Construct an item from @args in place at front of deque
+  // Complexity: O(1), plus O(N / kBlockSize) when the map grows
+  template <typename... Args>
+  void EmplaceFront(Args&&... args);
+  // Construct an item from @args in place at back of deque
+  // Complexity: O(1), plus O(N / kBlockSize) when the map grows
+  template <typename... Args>
+  void EmplaceBack(Args&&... args);
+  // Remove item at front of deque
+  // Complexity: O(1)
+  void PopFront();
+  // Remove item at back of deque
+  // Complexity: O(1)
+  void PopBack();
+  // Remove item at front of deque and return it, moved out
+  // Complexity: O(1)
+  T TakeFront();
+  // Remove item at back of deque and return it, moved out
+  // Complexity: O(1)
+  T TakeBack();
+
+ private:
+    static const size_t kShift = BlockDequeShift(kBlockSize);
+    // Ring of map_size block pointers; position p lives in block
+    // (p >> kShift) & (map_size - 1) at offset p & (kBlockSize - 1), so
+    // head and tail are logical counters that may wrap, as in Deque
+    T **map;
+    size_t head, tail, map_size;
+    std::vector<T*> spare;
+    T& at(size_t position) const noexcept;
+    T*& block(size_t position) const noexcept;
+    size_t blocks_in_use() const noexcept;
+    void resize_map(size_t new_size);
+    void acquire_block(size_t position);
+    void release_block(size_t position) noexcept;
+
+    // Copying would share the blocks, so a BlockDeque is not copyable
+    BlockDeque(const BlockDeque&) = delete;
+    BlockDeque& operator=(const BlockDeque&) = delete;
+};
+
+template <typename T>
+const size_t BlockDeque<T>::kBlockSize;
+
+template <typename T>
+const size_t BlockDeque<T>::kSpareBlocks;
+
+template <typename T>
+const size_t BlockDeque<T>::kShift;
+
+// Nothing is allocated until the first push
+template <typename T>
+BlockDeque<T>::BlockDeque() : map(nullptr), head(0), tail(0), map_size(0) {}
+
+template <typename T>
+BlockDeque<T>::~BlockDeque() {
+  Clear();
+  for (T *b : spare) {
+    ::operator delete(b);
+  }
+  delete[] map;
+}
+
+template<typename T>
+bool BlockDeque<T>::Empty() const noexcept {
+  return head == tail;
+}
+
+template<typename T>
+size_t BlockDeque<T>::Size() const noexcept {
+  return tail - head;
+}
+
+template<typename T>
+void BlockDeque<T>::ShrinkToFit() {
+  for (T *b : spare) {
+    ::operator delete(b);
+  }
+  spare.clear();
+  spare.shrink_to_fit();
+  size_t new_size = 1;
+  while (new_size < blocks_in_use()) {
+    new_size *= 2;
+  }
+  if (Empty()) {
+    delete[] map;
+    map = nullptr;
+    map_size = 0;
+  } else if (new_size < map_size) {
+    resize_map(new_size);
+  }
+}
+
+template<typename T>
+T& BlockDeque<T>::operator[](size_t pos) {
+  if (pos < Size()) {
+    return at(head + pos);
+  } else {
+    throw std::out_of_range("Incorrect Index");
+  }
+}
+
+template <typename T>
+T& BlockDeque<T>::Front() {
+  if (!Empty()) {
+    return at(head);
+  } else {
+    throw std::out_of_range("No front available");
+  }
+}
+
+template <typename T>
+T& BlockDeque<T>::Back() {
+  if (!Empty()) {
+    return at(tail - 1);
+  } else {
+    throw std::out_of_range("No back available");
+  }
+}
+
+// Destroy all items, keeping up to kSpareBlocks blocks and the map
+template <typename T>
+void BlockDeque<T>::Clear(void) noexcept {
+  while (!Empty()) {
+    at(head).~T();
+    head++;
+    if (Empty() || (head & (kBlockSize - 1)) == 0) {
+      release_block(head - 1);
+    }
+  }
+  head = 0;
+  tail = 0;
+}
+
+template <typename T>
+T& BlockDeque<T>::at(size_t position) const noexcept {
+  return block(position)[position & (kBlockSize - 1)];
+}
+
+template <typename T>
+T*& BlockDeque<T>::block(size_t position) const noexcept {
+  return map[(position >> kShift) & (map_size - 1)];
+}
+
+template <typename T>
+size_t BlockDeque<T>::blocks_in_use() const noexcept {
+  if (Empty()) {
+    return 0;
+  }
+  // Measured from the start of the front block, since block numbers do
+  // not wrap along with the counters
+  return ((tail - 1 - (head & ~(kBlockSize - 1))) >> kShift) + 1;
+}
+
+// Move the block pointers in use into a map of @new_size (a power of two)
+template <typename T>
+void BlockDeque<T>::resize_map(size_t new_size) {
+  T **new_map = new T*[new_size]();
+  size_t first = head >> kShift;
+  for (size_t i = 0; i < blocks_in_use(); i++) {
+    new_map[(first + i) & (new_size - 1)] = map[(first + i) & (map_size - 1)];
+  }
+  delete[] map;
+  map = new_map;
+  map_size = new_size;
+}
+
+// Give the block holding @position a block, growing the map if every
+// slot is in use
+template <typename T>
+void BlockDeque<T>::acquire_block(size_t position) {
+  if (blocks_in_use() == map_size) {
+    resize_map(map_size ? map_size * 2 : 4);
+  }
+  T *b;
+  if (!spare.empty()) {
+    b = spare.back();
+    spare.pop_back();
+  } else {
+    b = static_cast<T*>(::operator new(kBlockSize * sizeof(T)));
+  }
+  block(position) = b;
+}
+
+// The block holding @position has no items left
+template <typename T>
+void BlockDeque<T>::release_block(size_t position) noexcept {
+  T *&b = block(position);
+  if (spare.size() < kSpareBlocks) {
+    try {
+      spare.push_back(b);
+      b = nullptr;
+      return;
+    } catch (...) {
+    }
+  }
+  ::operator delete(b);
+  b = nullptr;
+}
+
+template <typename T>
+template <typename... Args>
+void BlockDeque<T>::EmplaceFront(Args&&... args) {
+  static_assert(alignof(T) <= alignof(std::max_align_t),
+    "BlockDeque does not support over-aligned types");
+  size_t position = head - 1;
+  bool fresh = Empty() || (head & (kBlockSize - 1)) == 0;
+  if (fresh) {
+    acquire_block(position);
+  }
+  try {
+    new (&at(position)) T(std::forward<Args>(args)...);
+  } catch (...) {
+    if (fresh) {
+      release_block(position);
+    }
+    throw;
+  }
+  head = position;
+}
+
+template <typename T>
+template <typename... Args>
+void BlockDeque<T>::EmplaceBack(Args&&... args) {
+  static_assert(alignof(T) <= alignof(std::max_align_t),
+    "BlockDeque does not support over-aligned types");
+  bool fresh = Empty() || (tail & (kBlockSize - 1)) == 0;
+  if (fresh) {
+    acquire_block(tail);
+  }
+  try {
+    new (&at(tail)) T(std::forward<Args>(args)...);
+  } catch (...) {
+    if (fresh) {
+      release_block(tail);
+    }
+    throw;
+  }
+  tail++;
+}
+
+template <typename T>
+void BlockDeque<T>::PushFront(const T &value) {
+  EmplaceFront(value);
+}
+
+template <typename T>
+void BlockDeque<T>::PushFront(T &&value) {
+  EmplaceFront(std::move(value));
+}
+
+template <typename T>
+void BlockDeque<T>::PushBack(const T &value) {
+  EmplaceBack(value);
+}
+
+template <typename T>
+void BlockDeque<T>::PushBack(T &&value) {
+  EmplaceBack(std::move(value));
+}
+
+template <typename T>
+void BlockDeque<T>::PopFront() {
+  if (Empty()) {
+    throw std::out_of_range("Deque has no values");
+  }
+  at(head).~T();
+  head++;
+  if (Empty() || (head & (kBlockSize - 1)) == 0) {
+    release_block(head - 1);
+  }
+}
+
+template <typename T>
+void BlockDeque<T>::PopBack() {
+  if (Empty()) {
+    throw std::out_of_range("Deque has no values");
+  }
+  tail--;
+  at(tail).~T();
+  if (Empty() || (tail & (kBlockSize - 1)) == 0) {
+    release_block(tail);
+  }
+}
+
+template <typename T>
+T BlockDeque<T>::TakeFront() {
+  if (Empty()) {
+    throw std::out_of_range("Deque has no values");
+  }
+  T value(std::move(at(head)));
+  PopFront();
+  return value;
+}
+
+template <typename T>
+T BlockDeque<T>::TakeBack() {
+  if (Empty()) {
+    throw std::out_of_range("Deque has no values");
+  }
+  T value(std::move(at(tail - 1)));
+  PopBack();
+  return value;
+}
+
+#endif  // BLOCK_DEQUE_H_
@@ -1,23 +1,149 @@
 #ifndef DEQUE_H_
 #define DEQUE_H_
 
+#include <algorithm>
 #include <cstddef>
+#include <cstring>
 #include <exception>
 #include <iostream>
+#include <iterator>
 #include <memory>
+#if __cplusplus >= 201703L
+#include <memory_resource>
+#endif
+#include <new>
+#include <stdexcept>
+#include <type_traits>
 #include <utility>
 
-template<typename T>
+// A contiguous run of @size items starting at @data
+template <typename V>
+struct DequeSpan {
+  V *data;
+  size_t size;
+
+  V* begin() const noexcept { return data; }
+  V* end() const noexcept { return data + size; }
+};
+
+// Random-access iterator over a Deque; V is T or const T. It holds the
+// logical position, like the deque's head and tail, and reaches the array
+// through the same mask, so stepping past the end of the array is free.
+// Any push or pop that grows or shrinks the array invalidates it
+template <typename V>
+class DequeIterator {
+ public:
+  typedef std::random_access_iterator_tag iterator_category;
+  typedef typename std::remove_const<V>::type value_type;
+  typedef ptrdiff_t difference_type;
+  typedef V* pointer;
+  typedef V& reference;
+
+  DequeIterator() noexcept : array(nullptr), mask(0), index(0) {}
+  DequeIterator(V *array, size_t mask, size_t index) noexcept
+    : array(array), mask(mask), index(index) {}
+  // An iterator converts to a const_iterator
+  template <typename U, typename = typename std::enable_if<
+    std::is_convertible<U*, V*>::value>::type>
+  DequeIterator(const DequeIterator<U> &other) noexcept
+    : array(other.array), mask(other.mask), index(other.index) {}
+
+  V& operator*() const noexcept { return array[index & mask]; }
+  V* operator->() const noexcept { return &array[index & mask]; }
+  V& operator[](difference_type n) const noexcept {
+    return array[(index + n) & mask];
+  }
+
+  DequeIterator& operator++() noexcept { index++; return *this; }
+  DequeIterator& operator--() noexcept { index--; return *this; }
+  DequeIterator operator++(int) noexcept { return {array, mask, index++}; }
+  DequeIterator operator--(int) noexcept { return {array, mask, index--}; }
+  DequeIterator& operator+=(difference_type n) noexcept {
+    index += n;
+    return *this;
+  }
+  DequeIterator& operator-=(difference_type n) noexcept {
+    index -= n;
+    return *this;
+  }
+
+  friend DequeIterator operator+(DequeIterator it, difference_type n) {
+    return it += n;
+  }
+  friend DequeIterator operator+(difference_type n, DequeIterator it) {
+    return it += n;
+  }
+  friend DequeIterator operator-(DequeIterator it, difference_type n) {
+    return it -= n;
+  }
+  // Positions wrap like the counters, so the distance is taken modulo the
+  // range of size_t
+  friend difference_type operator-(const DequeIterator &a,
+    const DequeIterator &b) {
+    return static_cast<difference_type>(a.index - b.index);
+  }
+  friend bool operator==(const DequeIterator &a, const DequeIterator &b) {
+    return a.index == b.index;
+  }
+  friend bool operator!=(const DequeIterator &a, const DequeIterator &b) {
+    return a.index != b.index;
+  }
+  friend bool operator<(const DequeIterator &a, const DequeIterator &b) {
+    return a - b < 0;
+  }
+  friend bool operator>(const DequeIterator &a, const DequeIterator &b) {
+    return a - b > 0;
+  }
+  friend bool operator<=(const DequeIterator &a, const DequeIterator &b) {
+    return a - b <= 0;
+  }
+  friend bool operator>=(const DequeIterator &a, const DequeIterator &b) {
+    return a - b >= 0;
+  }
+
+ private:
+    template <typename U> friend class DequeIterator;
+    V *array;
+    size_t mask, index;
+};
+
+// Room for @N items inside a Deque, so short deques need no heap at all
+template <typename T, size_t N>
+struct DequeInlineStorage {
+  typename std::aligned_storage<N * sizeof(T), alignof(T)>::type storage;
+
+  T* data() noexcept { return reinterpret_cast<T*>(&storage); }
+};
+
+template <typename T>
+struct DequeInlineStorage<T, 0> {
+  T* data() noexcept { return nullptr; }
+};
+
+// Every allocation and free of the array, and every item constructed in or
+// destroyed from it, goes through @Allocator, so a deque can live in an
+// arena or a std::pmr::memory_resource (see pmr::Deque below).
+//
+// @N, 0 or a power of two, is the number of items held inside the object
+// itself. When it is not 0, that inline buffer is the first array: the
+// deque allocates only once it holds more than @N items, and ShrinkToFit
+// moves the items back in once they fit again. See SmallDeque below
+template<typename T, typename Allocator = std::allocator<T>,
+  size_t N = 0>
 class Deque {
  public:
-  //
-  // @@@ The class's public API below should _not_ be modified @@@
-  //
+  typedef Allocator allocator_type;
+  // Items held without allocating
+  static const size_t kInlineCapacity = N;
 
   // Constructor
   Deque();
+  // Constructor, all storage comes from @allocator
+  explicit Deque(const Allocator &allocator);
   // Destructor
   ~Deque();
+  // Return a copy of the allocator
+  Allocator GetAllocator() const noexcept;
 
 
   //
@@ -30,10 +156,36 @@ class Deque {
   // Return number of items in deque
   // Complexity: O(1)
   size_t Size() const noexcept;
+  // Return number of items the deque holds before it has to grow
+  // Complexity: O(1)
+  size_t Capacity() const noexcept;
   // Resize internal data structure to fit precisely the number of items and
-  // free unused memory
+  // free unused memory; this also drops what Reserve() asked for
   // Complexity: O(N)
   void ShrinkToFit();
+  // Grow the array so @n items fit without growing again, and keep
+  // automatic shrinking from going below that
+  // Complexity: O(N) if it grows, otherwise O(1)
+  void Reserve(size_t n);
+  // Turn automatic shrinking on or off (it is off by default). When on, a
+  // pop that leaves the array less than a quarter full halves it; since
+  // that leaves it under half full, it takes doubling the items to grow it
+  // again, so a deque hovering around a boundary does not reallocate on
+  // every push and pop
+  // Complexity: O(1)
+  void SetAutoShrink(bool enabled) noexcept;
+  // Turn ring mode on for at most @n items, or off if @n is 0. Once the
+  // deque holds @n items, a push overwrites the item at the other end
+  // instead of growing it: PushBack drops the front, oldest item, so the
+  // deque keeps the last @n items, like a fixed-memory event buffer, and
+  // PushFront drops the back one. The array for @n items is allocated
+  // here and kept, so pushes in ring mode never allocate; if the deque
+  // holds more than @n items, the ones at front are dropped
+  // Complexity: O(N) if it grows or drops items, otherwise O(1)
+  void SetRing(size_t n);
+  // Return the item count set by SetRing(), 0 when ring mode is off
+  // Complexity: O(1)
+  size_t RingSize() const noexcept;
 
 
   //
@@ -51,6 +203,41 @@ class Deque {
   T& Back();
 
 
+  //
+  // Iterators
+  //
+
+  typedef DequeIterator<T> iterator;
+  typedef DequeIterator<const T> const_iterator;
+  typedef std::reverse_iterator<iterator> reverse_iterator;
+  typedef std::reverse_iterator<const_iterator> const_reverse_iterator;
+
+  // Iterators from front to back, usable with range-for and <algorithm>
+  // Complexity: O(1)
+  iterator begin() noexcept;
+  iterator end() noexcept;
+  const_iterator begin() const noexcept;
+  const_iterator end() const noexcept;
+  const_iterator cbegin() const noexcept;
+  const_iterator cend() const noexcept;
+  // Iterators from back to front
+  // Complexity: O(1)
+  reverse_iterator rbegin() noexcept;
+  reverse_iterator rend() noexcept;
+  const_reverse_iterator rbegin() const noexcept;
+  const_reverse_iterator rend() const noexcept;
+  // Return the items in order as at most two contiguous spans, the second
+  // one empty unless the items wrap around the end of the array
+  // Complexity: O(1)
+  std::pair<DequeSpan<T>, DequeSpan<T>> Segments() noexcept;
+  std::pair<DequeSpan<const T>, DequeSpan<const T>> Segments() const noexcept;
+  // Copy the items in order into @out, which has room for Size() items,
+  // and return how many were copied; that is one memcpy per non-empty
+  // span of Segments() when T is trivially copyable
+  // Complexity: O(N)
+  size_t Snapshot(T *out) const;
+
+
   //
   // Modifiers
   //
@@ -59,225 +246,815 @@ class Deque {
   // Complexity: O(1)
   void Clear(void) noexcept;
   // Push item @value at front of deque
-  // Complexity: O(1) amortized
+  // Complexity: O(1) amortized, O(1) in ring mode
   void PushFront(const T &value);
+  void PushFront(T &&value);
   // Push item @value at back of deque
-  // Complexity: O(1) amortized
+  // Complexity: O(1) amortized, O(1) in ring mode
   void PushBack(const T &value);
+  void PushBack(T &&value);
+  // Construct an item from @args in place at front of deque
+  // Complexity: O(1) amortized
+  template <typename... Args>
+  void EmplaceFront(Args&&... args);
+  // Construct an item from @args in place at back of deque
+  // Complexity: O(1) amortized
+  template <typename... Args>
+  void EmplaceBack(Args&&... args);
   // Remove item at front of deque
   // Complexity: O(1) amortized
   void PopFront();
   // Remove item at back of deque
-  void PopBack();
   // Complexity: O(1) amortized
+  void PopBack();
+  // Remove item at front of deque and return it, moved out
+  // Complexity: O(1)
+  T TakeFront();
+  // Remove item at back of deque and return it, moved out
+  // Complexity: O(1)
+  T TakeBack();
+  // Push copies of the @n items at @items at back of deque, in order;
+  // @items must not point into this deque. In ring mode only the last
+  // RingSize() of them can stay
+  // Complexity: O(n) amortized
+  void PushBackRange(const T *items, size_t n);
+  // Push copies of the @n items at @items at front of deque, keeping their
+  // order, so @items[0] becomes the front; @items must not point into this
+  // deque. In ring mode only the first RingSize() of them can stay
+  // Complexity: O(n) amortized
+  void PushFrontRange(const T *items, size_t n);
+  // Move up to @n items from front of deque into @out, in order, remove
+  // them and return how many there were; if a move throws, the items
+  // moved before it are removed and the one that threw stays the front
+  // Complexity: O(n)
+  size_t PopFrontInto(T *out, size_t n);
+  // Move up to @n items from back of deque into @out, in the order they
+  // were in the deque, remove them and return how many there were; items
+  // are moved from the back, so if a move throws, the ones after it are
+  // removed and the one that threw stays the back
+  // Complexity: O(n)
+  size_t PopBackInto(T *out, size_t n);
 
  private:
-    std::unique_ptr<T[]> array;
-    int size, array_size, front, tail;
-    bool check_full();
-    void resize(int position);
+    // Raw storage for array_size items; only the slots between head and
+    // tail hold constructed objects
+    T *array;
+    // Logical positions of the first item and one past the last; they only
+    // ever reach the array through & (array_size - 1), so they may wrap and
+    // size is always tail - head
+    size_t head, tail, array_size;
+    Allocator alloc;
+    // The array while the items fit in it; an empty struct when N is 0
+    DequeInlineStorage<T, N> local;
+    static_assert((N & (N - 1)) == 0, "Inline capacity must be a power of two");
+    // Capacity last asked for by Reserve()
+    size_t reserved;
+    bool auto_shrink;
+    // Item count at which pushes overwrite instead of growing; kNoRing
+    // unless ring mode is on, so the check costs a single comparison
+    size_t ring_size;
+    static const size_t kNoRing = static_cast<size_t>(-1);
+    // Capacity of the first allocation, made on the first push
+    static const size_t kMinSize = 4;
+    typedef std::allocator_traits<Allocator> AllocTraits;
+    T* allocate(size_t n);
+    void deallocate(T *p, size_t n) noexcept;
+    template <typename... Args>
+    void construct(T *p, Args&&... args);
+    void destroy(T *p) noexcept;
+    size_t mask() const noexcept;
+    bool check_full() const noexcept;
+    void relocate(T *new_array, size_t new_size);
+    void resize(size_t new_size);
+    void shrink_if_sparse() noexcept;
+    template <typename... Args>
+    void grow_emplace(bool front, Args&&... args);
+    template <typename... Args>
+    void overwrite(bool front, Args&&... args);
+    void drop_front(size_t n) noexcept;
+    void drop_back(size_t n) noexcept;
+    void make_room(size_t n);
+    template <typename F>
+    void for_each_run(size_t position, size_t n, F f);
+    void copy_in(size_t position, const T *items, size_t n,
+      std::true_type);
+    void copy_in(size_t position, const T *items, size_t n,
+      std::false_type);
+    void move_out(bool front, T *out, size_t n, std::true_type);
+    void move_out(bool front, T *out, size_t n, std::false_type);
+    static void copy_out(const T *run, size_t n, T *out, std::true_type);
+    static void copy_out(const T *run, size_t n, T *out, std::false_type);
+
+    // Copying would share the storage, so a Deque is not copyable
+    Deque(const Deque&) = delete;
+    Deque& operator=(const Deque&) = delete;
 };
 
-template <typename T>
-Deque<T>::Deque() : array(std::unique_ptr<T[]>(new T[3])),
-size(0), array_size(3), front(-1), tail(0) {}
+template <typename T, typename Allocator, size_t N>
+const size_t Deque<T, Allocator, N>::kInlineCapacity;
 
-template <typename T>
-Deque<T>::~Deque() = default;
+template <typename T, typename Allocator, size_t N>
+const size_t Deque<T, Allocator, N>::kMinSize;
 
-template<typename T>
-bool Deque<T>::Empty() const noexcept {
-  if (size == 0) {
-    return true;
-  } else {
-    return false;
+template <typename T, typename Allocator, size_t N>
+const size_t Deque<T, Allocator, N>::kNoRing;
+
+// Capacity always is a power of two so wraparound is a mask, not a branch;
+// nothing is allocated until the first push
+template <typename T, typename Allocator, size_t N>
+Deque<T, Allocator, N>::Deque() : array(nullptr), head(0), tail(0),
+  array_size(N), reserved(0), auto_shrink(false), ring_size(kNoRing) {
+  array = local.data();
+}
+
+template <typename T, typename Allocator, size_t N>
+Deque<T, Allocator, N>::Deque(const Allocator &allocator) : array(nullptr),
+  head(0), tail(0), array_size(N), alloc(allocator), reserved(0),
+  auto_shrink(false), ring_size(kNoRing) {
+  array = local.data();
+}
+
+template <typename T, typename Allocator, size_t N>
+Deque<T, Allocator, N>::~Deque() {
+  Clear();
+  deallocate(array, array_size);
+}
+
+template <typename T, typename Allocator, size_t N>
+Allocator Deque<T, Allocator, N>::GetAllocator() const noexcept {
+  return alloc;
+}
+
+template <typename T, typename Allocator, size_t N>
+bool Deque<T, Allocator, N>::Empty() const noexcept {
+  return head == tail;
+}
+
+template <typename T, typename Allocator, size_t N>
+size_t Deque<T, Allocator, N>::Size() const noexcept {
+  return tail - head;
+}
+
+template <typename T, typename Allocator, size_t N>
+size_t Deque<T, Allocator, N>::Capacity() const noexcept {
+  return array_size;
+}
+
+// Shrink to the smallest power of two that holds the items, or into the
+// inline buffer if they fit there; an empty deque frees its array. In ring
+// mode the array stays large enough for the ring
+template <typename T, typename Allocator, size_t N>
+void Deque<T, Allocator, N>::ShrinkToFit() {
+  reserved = 0;
+  size_t keep = ring_size == kNoRing ? Size() : ring_size;
+  if (keep == 0) {
+    deallocate(array, array_size);
+    array = local.data();
+    array_size = N;
+    head = 0;
+    tail = 0;
+    return;
+  }
+  // Inline even when @N is below kMinSize
+  if (keep <= N) {
+    resize(N);
+    return;
+  }
+  size_t new_size = kMinSize;
+  while (new_size < keep) {
+    new_size *= 2;
+  }
+  if (new_size < array_size) {
+    resize(new_size);
   }
 }
 
-template<typename T>
-size_t Deque<T>::Size() const noexcept {
-  return size;
+template <typename T, typename Allocator, size_t N>
+void Deque<T, Allocator, N>::Reserve(size_t n) {
+  if (n > Size()) {
+    make_room(n - Size());
+  }
+  reserved = std::max(reserved, n);
 }
 
-// Shrink array of the more than 75% of array is not
-// being used, shrink size by half
-template<typename T>
-void Deque<T>::ShrinkToFit() {
-  if (array_size/4 > size) {
-    std::unique_ptr <T[]> new_array(new T[array_size/2]);
-    int temp_front = front;
-    for (auto i = 0; i < size; i++) {
-      if (temp_front >= array_size) {
-        temp_front = 0;
-      }
-      new_array[i] = array[temp_front];
-      temp_front++;
-    }
-    front = 0;
-    tail = size - 1;
-    array_size /= 2;
-    array = std::move(new_array);
+template <typename T, typename Allocator, size_t N>
+void Deque<T, Allocator, N>::SetAutoShrink(bool enabled) noexcept {
+  auto_shrink = enabled;
+}
+
+// The array grows before any item is dropped, so if it cannot the deque
+// is left unchanged
+template <typename T, typename Allocator, size_t N>
+void Deque<T, Allocator, N>::SetRing(size_t n) {
+  if (n == 0) {
+    ring_size = kNoRing;
+    return;
+  }
+  if (n > Size()) {
+    make_room(n - Size());
+  } else {
+    drop_front(Size() - n);
   }
+  ring_size = n;
 }
 
-template<typename T>
-T& Deque<T>::operator[](size_t pos) {
-  int a = static_cast<int>(pos);
-  if (a >= 0 && a < size) {
-    if (front + a < array_size) {
-      return array[front + pos];
-    } else {
-      int rest = front + pos - array_size;
-      return array[rest];
-    }
+template <typename T, typename Allocator, size_t N>
+size_t Deque<T, Allocator, N>::RingSize() const noexcept {
+  return ring_size == kNoRing ? 0 : ring_size;
+}
+
+template <typename T, typename Allocator, size_t N>
+T& Deque<T, Allocator, N>::operator[](size_t pos) {
+  if (pos < Size()) {
+    return array[(head + pos) & mask()];
   } else {
     throw std::out_of_range("Incorrect Index");
   }
 }
 
-template <typename T>
-T& Deque<T>::Front() {
-  if (size > 0) {
-    return array[front];
+template <typename T, typename Allocator, size_t N>
+T& Deque<T, Allocator, N>::Front() {
+  if (!Empty()) {
+    return array[head & mask()];
   } else {
     throw std::out_of_range("No front available");
   }
 }
 
-template <typename T>
-T& Deque<T>::Back() {
-  if (size > 0) {
-    return array[tail];
+template <typename T, typename Allocator, size_t N>
+T& Deque<T, Allocator, N>::Back() {
+  if (!Empty()) {
+    return array[(tail - 1) & mask()];
   } else {
     throw std::out_of_range("No back available");
   }
 }
 
-template <typename T>
-void Deque<T>::Clear(void) noexcept {
-  std::unique_ptr <T[]> new_array(new T[3]);
-  array_size = 3;
-  size = 0;
-  front = -1;
-  tail = 0;
+template <typename T, typename Allocator, size_t N>
+typename Deque<T, Allocator, N>::iterator
+Deque<T, Allocator, N>::begin() noexcept {
+  return iterator(array, mask(), head);
 }
 
-template <typename T>
-bool Deque<T>::check_full() {
-  if (size == array_size) {
-    return true;
-  } else {
-    return false;
+template <typename T, typename Allocator, size_t N>
+typename Deque<T, Allocator, N>::iterator
+Deque<T, Allocator, N>::end() noexcept {
+  return iterator(array, mask(), tail);
+}
+
+template <typename T, typename Allocator, size_t N>
+typename Deque<T, Allocator, N>::const_iterator
+Deque<T, Allocator, N>::begin() const noexcept {
+  return const_iterator(array, mask(), head);
+}
+
+template <typename T, typename Allocator, size_t N>
+typename Deque<T, Allocator, N>::const_iterator
+Deque<T, Allocator, N>::end() const noexcept {
+  return const_iterator(array, mask(), tail);
+}
+
+template <typename T, typename Allocator, size_t N>
+typename Deque<T, Allocator, N>::const_iterator
+Deque<T, Allocator, N>::cbegin() const noexcept {
+  return begin();
+}
+
+template <typename T, typename Allocator, size_t N>
+typename Deque<T, Allocator, N>::const_iterator
+Deque<T, Allocator, N>::cend() const noexcept {
+  return end();
+}
+
+template <typename T, typename Allocator, size_t N>
+typename Deque<T, Allocator, N>::reverse_iterator
+Deque<T, Allocator, N>::rbegin() noexcept {
+  return reverse_iterator(end());
+}
+
+template <typename T, typename Allocator, size_t N>
+typename Deque<T, Allocator, N>::reverse_iterator
+Deque<T, Allocator, N>::rend() noexcept {
+  return reverse_iterator(begin());
+}
+
+template <typename T, typename Allocator, size_t N>
+typename Deque<T, Allocator, N>::const_reverse_iterator
+Deque<T, Allocator, N>::rbegin() const noexcept {
+  return const_reverse_iterator(end());
+}
+
+template <typename T, typename Allocator, size_t N>
+typename Deque<T, Allocator, N>::const_reverse_iterator
+Deque<T, Allocator, N>::rend() const noexcept {
+  return const_reverse_iterator(begin());
+}
+
+template <typename T, typename Allocator, size_t N>
+std::pair<DequeSpan<T>, DequeSpan<T>>
+Deque<T, Allocator, N>::Segments() noexcept {
+  if (Empty()) {
+    return {{array, 0}, {array, 0}};
   }
+  size_t first = head & mask();
+  size_t count = Size();
+  size_t before_end = array_size - first;
+  if (count <= before_end) {
+    return {{array + first, count}, {array, 0}};
+  }
+  return {{array + first, before_end}, {array, count - before_end}};
 }
 
-// Increase the size of array by 2 and copy everthing from original
-template <typename T>
-void Deque<T>::resize(int position) {
-  int count = 0;
-  std::unique_ptr <T[]> new_array(new T[array_size*2]);
-  for (auto i = 0; i < array_size; i++) {
-    if (position == i) {
-      count = i + size;
+template <typename T, typename Allocator, size_t N>
+std::pair<DequeSpan<const T>, DequeSpan<const T>>
+Deque<T, Allocator, N>::Segments() const noexcept {
+  auto spans = const_cast<Deque*>(this)->Segments();
+  return {{spans.first.data, spans.first.size},
+    {spans.second.data, spans.second.size}};
+}
+
+template <typename T, typename Allocator, size_t N>
+size_t Deque<T, Allocator, N>::Snapshot(T *out) const {
+  auto spans = Segments();
+  copy_out(spans.first.data, spans.first.size, out,
+    std::is_trivially_copyable<T>());
+  copy_out(spans.second.data, spans.second.size, out + spans.first.size,
+    std::is_trivially_copyable<T>());
+  return Size();
+}
+
+// Destroy all items but keep the array for reuse
+// O(1) when T has nothing to destroy
+template <typename T, typename Allocator, size_t N>
+void Deque<T, Allocator, N>::Clear(void) noexcept {
+  if (!std::is_trivially_destructible<T>::value) {
+    for (; head != tail; head++) {
+      destroy(array + (head & mask()));
     }
-    new_array[count] = array[i];
-    count++;
   }
-  array = std::move(new_array);
-  array_size *= 2;
+  head = 0;
+  tail = 0;
 }
 
-template <typename T>
-void Deque<T>::PushFront(const T &value) {
-  if (Empty()) {
-    front = 0;
-    tail = 0;
-    std::unique_ptr <T[]> new_array(new T[3]);
-    array = std::move(new_array);
-    array_size = 3;
-  } else if (front == 0) {
-    front = array_size - 1;
-    if (check_full()) {
-      resize(array_size);
-      front = array_size - 1;
+// Uninitialized storage for @n items
+template <typename T, typename Allocator, size_t N>
+T* Deque<T, Allocator, N>::allocate(size_t n) {
+  // Before C++17 std::allocator ignores alignment beyond max_align_t
+  static_assert(__cplusplus >= 201703L ||
+    alignof(T) <= alignof(std::max_align_t),
+    "Deque does not support over-aligned types before C++17");
+  return AllocTraits::allocate(alloc, n);
+}
+
+// Free storage @p for @n items, which may be nullptr or the inline buffer
+template <typename T, typename Allocator, size_t N>
+void Deque<T, Allocator, N>::deallocate(T *p, size_t n) noexcept {
+  if (p && p != local.data()) {
+    AllocTraits::deallocate(alloc, p, n);
+  }
+}
+
+template <typename T, typename Allocator, size_t N>
+template <typename... Args>
+void Deque<T, Allocator, N>::construct(T *p, Args&&... args) {
+  AllocTraits::construct(alloc, p, std::forward<Args>(args)...);
+}
+
+template <typename T, typename Allocator, size_t N>
+void Deque<T, Allocator, N>::destroy(T *p) noexcept {
+  AllocTraits::destroy(alloc, p);
+}
+
+template <typename T, typename Allocator, size_t N>
+size_t Deque<T, Allocator, N>::mask() const noexcept {
+  return array_size - 1;
+}
+
+template <typename T, typename Allocator, size_t N>
+bool Deque<T, Allocator, N>::check_full() const noexcept {
+  return tail - head == array_size;
+}
+
+// Move every item into @new_array of @new_size (a power of two, at least
+// Size()), unwrapped so the front lands at index 0, and free the old array.
+// Items are copied instead when their move may throw; if that copy throws,
+// @new_array is freed and the deque is left untouched
+template <typename T, typename Allocator, size_t N>
+void Deque<T, Allocator, N>::relocate(T *new_array, size_t new_size) {
+  size_t count = tail - head;
+  size_t i = 0;
+  try {
+    for (; i < count; i++) {
+      construct(new_array + i,
+        std::move_if_noexcept(array[(head + i) & mask()]));
     }
-  } else {
-    front = front - 1;
-    if (check_full()) {
-      front += 1;
-      resize(front);
-      front += size - 1;
+  } catch (...) {
+    while (i > 0) {
+      destroy(new_array + --i);
     }
+    deallocate(new_array, new_size);
+    throw;
   }
-  size += 1;
-  array[front] = value;
+  Clear();
+  deallocate(array, array_size);
+  array = new_array;
+  array_size = new_size;
+  head = 0;
+  tail = count;
 }
 
-template <typename T>
-void Deque<T>::PushBack(const T &value) {
-  if (Empty()) {
-    front = 0;
-    tail = 0;
-    std::unique_ptr <T[]> new_array(new T[3]);
-    array = std::move(new_array);
-    array_size = 3;
-  } else if ( tail == size -1 ) {
+// Move the items into a new array of @new_size, or back into the inline
+// buffer when that is large enough
+template <typename T, typename Allocator, size_t N>
+void Deque<T, Allocator, N>::resize(size_t new_size) {
+  if (new_size > N) {
+    relocate(allocate(new_size), new_size);
+  } else if (array != local.data()) {
+    relocate(local.data(), N);
+  }
+}
+
+// Once automatic shrinking is on, halve an array under a quarter full, as
+// often as that holds after a bulk pop, down to what Reserve() asked for;
+// the pop that got here does not fail if the smaller array cannot be had,
+// the deque just stays as large as it is
+template <typename T, typename Allocator, size_t N>
+void Deque<T, Allocator, N>::shrink_if_sparse() noexcept {
+  if (Size() >= array_size / 4 || array == local.data()) {
+    return;
+  }
+  size_t floor = std::max(reserved, kMinSize);
+  if (ring_size != kNoRing) {
+    floor = std::max(floor, ring_size);
+  }
+  size_t new_size = array_size;
+  while (Size() < new_size / 4 && new_size / 2 >= floor) {
+    new_size /= 2;
+  }
+  if (new_size == array_size) {
+    return;
+  }
+  try {
+    resize(new_size);
+  } catch (...) {
+  }
+}
+
+// Construct an item from @args at the front or back of a full deque: it
+// is built in the new, twice as large array before the items move over, as
+// @args may refer to one of them
+template <typename T, typename Allocator, size_t N>
+template <typename... Args>
+void Deque<T, Allocator, N>::grow_emplace(bool front, Args&&... args) {
+  size_t new_size = array_size ? array_size * 2 : kMinSize;
+  size_t at = front ? new_size - 1 : Size();
+  T *new_array = allocate(new_size);
+  try {
+    construct(new_array + at, std::forward<Args>(args)...);
+  } catch (...) {
+    deallocate(new_array, new_size);
+    throw;
+  }
+  try {
+    relocate(new_array, new_size);
+  } catch (...) {
+    // relocate already freed @new_array, only the new item is left
+    destroy(new_array + at);
+    throw;
+  }
+  if (front) {
+    head--;
+  } else {
     tail++;
-    if (check_full()) {
-      resize(tail);
-    }
-  } else if (tail == array_size - 1) {
-    if (front != 0) {
-      tail = 0;
+  }
+}
+
+// Construct an item from @args at the front or back of a deque holding
+// ring_size items and drop the one at the other end, without allocating.
+// The new item exists before the old one goes, as @args may refer to it:
+// it is built in a free slot if the array has one, otherwise aside and
+// then moved into the slot of the old item; if that move throws, the old
+// item is gone and the new one is not there
+template <typename T, typename Allocator, size_t N>
+template <typename... Args>
+void Deque<T, Allocator, N>::overwrite(bool front, Args&&... args) {
+  if (!check_full()) {
+    construct(array + ((front ? head - 1 : tail) & mask()),
+      std::forward<Args>(args)...);
+    if (front) {
+      head--;
+      drop_back(1);
     } else {
       tail++;
-      resize(tail);
+      drop_front(1);
     }
+    return;
+  }
+  T value(std::forward<Args>(args)...);
+  if (front) {
+    drop_back(1);
+    construct(array + ((head - 1) & mask()), std::move_if_noexcept(value));
+    head--;
   } else {
+    drop_front(1);
+    construct(array + (tail & mask()), std::move_if_noexcept(value));
     tail++;
-    if (check_full()) {
-      resize(front);
-      front += size;
-    }
   }
-  size += 1;
-  array[tail] = value;
 }
 
-template <typename T>
-void Deque<T>::PopFront() {
+template <typename T, typename Allocator, size_t N>
+template <typename... Args>
+void Deque<T, Allocator, N>::EmplaceFront(Args&&... args) {
+  if (Size() == ring_size) {
+    overwrite(true, std::forward<Args>(args)...);
+    return;
+  }
+  if (check_full()) {
+    grow_emplace(true, std::forward<Args>(args)...);
+    return;
+  }
+  construct(array + ((head - 1) & mask()), std::forward<Args>(args)...);
+  head--;
+}
+
+template <typename T, typename Allocator, size_t N>
+template <typename... Args>
+void Deque<T, Allocator, N>::EmplaceBack(Args&&... args) {
+  if (Size() == ring_size) {
+    overwrite(false, std::forward<Args>(args)...);
+    return;
+  }
+  if (check_full()) {
+    grow_emplace(false, std::forward<Args>(args)...);
+    return;
+  }
+  construct(array + (tail & mask()), std::forward<Args>(args)...);
+  tail++;
+}
+
+template <typename T, typename Allocator, size_t N>
+void Deque<T, Allocator, N>::PushFront(const T &value) {
+  EmplaceFront(value);
+}
+
+template <typename T, typename Allocator, size_t N>
+void Deque<T, Allocator, N>::PushFront(T &&value) {
+  EmplaceFront(std::move(value));
+}
+
+template <typename T, typename Allocator, size_t N>
+void Deque<T, Allocator, N>::PushBack(const T &value) {
+  EmplaceBack(value);
+}
+
+template <typename T, typename Allocator, size_t N>
+void Deque<T, Allocator, N>::PushBack(T &&value) {
+  EmplaceBack(std::move(value));
+}
+
+template <typename T, typename Allocator, size_t N>
+void Deque<T, Allocator, N>::PopFront() {
   if (Empty()) {
     throw std::out_of_range("Deque has no values");
-  } else if (size == 1) {
-    front = -1;
-    tail = -1;
-    size -= 1;
-  } else if (front == array_size - 1) {
-    front = 0;
-    size -= 1;
-  } else {
-    front += 1;
-    size -= 1;
+  }
+  destroy(array + (head & mask()));
+  head++;
+  if (auto_shrink) {
+    shrink_if_sparse();
   }
 }
 
-template <typename T>
-void Deque<T>::PopBack() {
+template <typename T, typename Allocator, size_t N>
+void Deque<T, Allocator, N>::PopBack() {
   if (Empty()) {
     throw std::out_of_range("Deque has no values");
-  } else if (size == 1) {
-    front = -1;
-    tail = -1;
-    size -= 1;
-  } else if (tail== 0) {
-    tail = array_size - 1;
-    size -= 1;
+  }
+  tail--;
+  destroy(array + (tail & mask()));
+  if (auto_shrink) {
+    shrink_if_sparse();
+  }
+}
+
+template <typename T, typename Allocator, size_t N>
+T Deque<T, Allocator, N>::TakeFront() {
+  if (Empty()) {
+    throw std::out_of_range("Deque has no values");
+  }
+  T value(std::move(array[head & mask()]));
+  PopFront();
+  return value;
+}
+
+template <typename T, typename Allocator, size_t N>
+T Deque<T, Allocator, N>::TakeBack() {
+  if (Empty()) {
+    throw std::out_of_range("Deque has no values");
+  }
+  T value(std::move(array[(tail - 1) & mask()]));
+  PopBack();
+  return value;
+}
+
+// Destroy the @n items at front, or at back, without shrinking
+template <typename T, typename Allocator, size_t N>
+void Deque<T, Allocator, N>::drop_front(size_t n) noexcept {
+  for (; n > 0; n--) {
+    destroy(array + (head & mask()));
+    head++;
+  }
+}
+
+template <typename T, typename Allocator, size_t N>
+void Deque<T, Allocator, N>::drop_back(size_t n) noexcept {
+  for (; n > 0; n--) {
+    tail--;
+    destroy(array + (tail & mask()));
+  }
+}
+
+// Grow the array once so that @n more items fit
+template <typename T, typename Allocator, size_t N>
+void Deque<T, Allocator, N>::make_room(size_t n) {
+  // Checked before adding, so a huge @n cannot wrap around; the limit
+  // leaves room for rounding up to a power of two
+  size_t limit = AllocTraits::max_size(alloc) / 2;
+  if (n > limit || Size() > limit - n) {
+    throw std::length_error("Deque too large");
+  }
+  size_t needed = Size() + n;
+  if (needed <= array_size) {
+    return;
+  }
+  size_t new_size = array_size ? array_size : kMinSize;
+  while (new_size < needed) {
+    new_size *= 2;
+  }
+  resize(new_size);
+}
+
+// Call @f(run, count, offset) for the at most two contiguous runs of array
+// slots that hold the @n positions from @position on; @offset counts the
+// positions before @run
+template <typename T, typename Allocator, size_t N>
+template <typename F>
+void Deque<T, Allocator, N>::for_each_run(size_t position, size_t n,
+  F f) {
+  if (n == 0) {
+    return;
+  }
+  size_t first = position & mask();
+  size_t count = std::min(n, array_size - first);
+  f(array + first, count, 0);
+  if (count < n) {
+    f(array, n - count, count);
+  }
+}
+
+// Copy-construct @items into the free slots from @position on, a run at a
+// time with memcpy when T is trivially copyable
+template <typename T, typename Allocator, size_t N>
+void Deque<T, Allocator, N>::copy_in(size_t position, const T *items,
+  size_t n, std::true_type) {
+  for_each_run(position, n, [items](T *run, size_t count, size_t offset) {
+    memcpy(run, items + offset, count * sizeof(T));
+  });
+}
+
+// If a copy throws, the items copied so far are destroyed again
+template <typename T, typename Allocator, size_t N>
+void Deque<T, Allocator, N>::copy_in(size_t position, const T *items,
+  size_t n, std::false_type) {
+  size_t i = 0;
+  try {
+    for (; i < n; i++) {
+      construct(array + ((position + i) & mask()), items[i]);
+    }
+  } catch (...) {
+    while (i > 0) {
+      i--;
+      destroy(array + ((position + i) & mask()));
+    }
+    throw;
+  }
+}
+
+// Move the @n items at the front or back into @out, in order, and remove
+// them
+template <typename T, typename Allocator, size_t N>
+void Deque<T, Allocator, N>::move_out(bool front, T *out, size_t n,
+  std::true_type) {
+  for_each_run(front ? head : tail - n, n,
+    [out](T *run, size_t count, size_t offset) {
+    memcpy(out + offset, run, count * sizeof(T));
+  });
+  if (front) {
+    head += n;
   } else {
-    tail -= 1;
-    size -= 1;
+    tail -= n;
+  }
+}
+
+// One item at a time, inward from the end, so the deque stays whole if a
+// move throws
+template <typename T, typename Allocator, size_t N>
+void Deque<T, Allocator, N>::move_out(bool front, T *out, size_t n,
+  std::false_type) {
+  for (size_t i = 0; i < n; i++) {
+    if (front) {
+      T &item = array[head & mask()];
+      out[i] = std::move(item);
+      destroy(&item);
+      head++;
+    } else {
+      T &item = array[(tail - 1) & mask()];
+      out[n - 1 - i] = std::move(item);
+      destroy(&item);
+      tail--;
+    }
+  }
+}
+
+// Copy the @n items of @run to @out, with a single memcpy when T is
+// trivially copyable
+template <typename T, typename Allocator, size_t N>
+void Deque<T, Allocator, N>::copy_out(const T *run, size_t n, T *out,
+  std::true_type) {
+  if (n > 0) {
+    memcpy(out, run, n * sizeof(T));
+  }
+}
+
+template <typename T, typename Allocator, size_t N>
+void Deque<T, Allocator, N>::copy_out(const T *run, size_t n, T *out,
+  std::false_type) {
+  std::copy(run, run + n, out);
+}
+
+// If a copy throws, the deque is left unchanged, except that in ring mode
+// the items making room for the new ones are already gone
+template <typename T, typename Allocator, size_t N>
+void Deque<T, Allocator, N>::PushBackRange(const T *items, size_t n) {
+  if (ring_size != kNoRing) {
+    if (n > ring_size) {
+      items += n - ring_size;
+      n = ring_size;
+    }
+    if (n > ring_size - Size()) {
+      drop_front(n - (ring_size - Size()));
+    }
+  }
+  make_room(n);
+  copy_in(tail, items, n, std::is_trivially_copyable<T>());
+  tail += n;
+}
+
+template <typename T, typename Allocator, size_t N>
+void Deque<T, Allocator, N>::PushFrontRange(const T *items, size_t n) {
+  if (ring_size != kNoRing) {
+    n = std::min(n, ring_size);
+    if (n > ring_size - Size()) {
+      drop_back(n - (ring_size - Size()));
+    }
   }
+  make_room(n);
+  copy_in(head - n, items, n, std::is_trivially_copyable<T>());
+  head -= n;
 }
 
+template <typename T, typename Allocator, size_t N>
+size_t Deque<T, Allocator, N>::PopFrontInto(T *out, size_t n) {
+  n = std::min(n, Size());
+  move_out(true, out, n, std::is_trivially_copyable<T>());
+  if (auto_shrink) {
+    shrink_if_sparse();
+  }
+  return n;
+}
+
+template <typename T, typename Allocator, size_t N>
+size_t Deque<T, Allocator, N>::PopBackInto(T *out, size_t n) {
+  n = std::min(n, Size());
+  move_out(false, out, n, std::is_trivially_copyable<T>());
+  if (auto_shrink) {
+    shrink_if_sparse();
+  }
+  return n;
+}
+
+#if __cplusplus >= 201703L
+namespace pmr {
+
+// Deque drawing its storage from a std::pmr::memory_resource, e.g. a
+// monotonic_buffer_resource over a stack buffer for short-lived deques
+template <typename T>
+using Deque = ::Deque<T, std::pmr::polymorphic_allocator<T>>;
+
+}  // namespace pmr
+#endif
 
+// Deque keeping up to @N items (a power of two) inside the object
+template <typename T, size_t N>
+using SmallDeque = Deque<T, std::allocator<T>, N>;
 
 #endif  // DEQUE_H_
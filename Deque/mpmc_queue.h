@@ -0,0 +1,289 @@
+#ifndef MPMC_QUEUE_H_
+#define MPMC_QUEUE_H_
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <new>
+#include <stdexcept>
+#include <thread>
+#include <type_traits>
+#include <utility>
+
+// Bounded lock-free queue for any number of producer and consumer threads
+// (D. Vyukov's design). Like Deque it is a power-of-two ring reached
+// through logical counters masked by capacity - 1, but every slot carries
+// a sequence number saying whose turn it is: a slot at position p is free
+// for the producer claiming p when its sequence is p, and holds an item
+// for the consumer claiming p when it is p + 1. Producers and consumers
+// claim positions with a CAS on their own counter, so the two sides only
+// meet on the slots themselves.
+//
+// A claimed slot cannot be given back, so the constructor of T used by a
+// push and the move constructor and move assignment used by a pop should
+// not throw: if one does, the exception propagates, but the slot stays
+// claimed and every thread that reaches it later waits on it forever.
+template<typename T>
+class MpmcQueue {
+ public:
+  // Assumed cache line size; the two counters live this far apart
+  static const size_t kCacheLine = 64;
+
+  // Constructor, room for at least @capacity items (rounded up to a power
+  // of two, at least 2)
+  explicit MpmcQueue(size_t capacity);
+  // Destructor, destroys the items still queued; no thread may be using
+  // the queue
+  ~MpmcQueue();
+
+
+  //
+  // Capacity
+  //
+
+  // Return the number of items the queue holds when full
+  // Complexity: O(1)
+  size_t Capacity() const noexcept;
+  // Return number of items queued, a snapshot while threads are running
+  // Complexity: O(1)
+  size_t Size() const noexcept;
+  // Return true if Size() is 0
+  // Complexity: O(1)
+  bool Empty() const noexcept;
+
+
+  //
+  // Non-blocking operations
+  //
+
+  // Push item @value at back of queue, return false if it is full
+  // Complexity: O(1), lock-free
+  bool TryPush(const T &value);
+  bool TryPush(T &&value);
+  // Construct an item from @args at back of queue, return false if it is
+  // full
+  // Complexity: O(1), lock-free
+  template <typename... Args>
+  bool TryEmplace(Args&&... args);
+  // Move the front item into @out and remove it, return false if the
+  // queue is empty
+  // Complexity: O(1), lock-free
+  bool TryPop(T &out);
+
+
+  //
+  // Blocking operations, which spin and then yield until they succeed
+  //
+
+  // Push item @value at back of queue, waiting while it is full
+  void Push(const T &value);
+  void Push(T &&value);
+  // Remove the front item and return it, waiting while the queue is empty
+  T Pop();
+
+ private:
+    struct Slot {
+      std::atomic<size_t> sequence;
+      typename std::aligned_storage<sizeof(T), alignof(T)>::type storage;
+
+      T* item() noexcept { return reinterpret_cast<T*>(&storage); }
+    };
+    char pad0[kCacheLine];
+    Slot *slots;
+    size_t mask;
+    char pad1[kCacheLine];
+    // Next position a producer will claim
+    std::atomic<size_t> tail;
+    char pad2[kCacheLine];
+    // Next position a consumer will claim
+    std::atomic<size_t> head;
+    char pad3[kCacheLine];
+
+    Slot* claim_push();
+    Slot* claim_pop();
+    static void backoff(int *spins);
+
+    // The queue is shared by address; it is neither copied nor moved
+    MpmcQueue(const MpmcQueue&) = delete;
+    MpmcQueue& operator=(const MpmcQueue&) = delete;
+};
+
+template <typename T>
+const size_t MpmcQueue<T>::kCacheLine;
+
+template <typename T>
+MpmcQueue<T>::MpmcQueue(size_t capacity) : slots(nullptr), mask(0) {
+  static_assert(alignof(T) <= alignof(std::max_align_t),
+    "MpmcQueue does not support over-aligned types");
+  if (capacity == 0 ||
+    capacity > (static_cast<size_t>(-1) >> 1) / sizeof(Slot)) {
+    throw std::invalid_argument("Invalid capacity");
+  }
+  // With a single slot, "free for p + 1" and "full from p" look the same
+  size_t size = 2;
+  while (size < capacity) {
+    size *= 2;
+  }
+  slots = new Slot[size];
+  mask = size - 1;
+  for (size_t i = 0; i < size; i++) {
+    slots[i].sequence.store(i, std::memory_order_relaxed);
+  }
+  tail.store(0, std::memory_order_relaxed);
+  head.store(0, std::memory_order_relaxed);
+}
+
+template <typename T>
+MpmcQueue<T>::~MpmcQueue() {
+  size_t end = tail.load(std::memory_order_relaxed);
+  for (size_t i = head.load(std::memory_order_relaxed); i != end; i++) {
+    slots[i & mask].item()->~T();
+  }
+  delete[] slots;
+}
+
+template <typename T>
+size_t MpmcQueue<T>::Capacity() const noexcept {
+  return mask + 1;
+}
+
+template <typename T>
+size_t MpmcQueue<T>::Size() const noexcept {
+  size_t h = head.load(std::memory_order_acquire);
+  size_t t = tail.load(std::memory_order_acquire);
+  // Read apart: the head is read first, so the tail is never behind it,
+  // but by the time the tail is read consumers may have popped and
+  // producers pushed past that head; the queue was full in between
+  return std::min(t - h, mask + 1);
+}
+
+template <typename T>
+bool MpmcQueue<T>::Empty() const noexcept {
+  return Size() == 0;
+}
+
+// Claim the slot at the tail for a push, or return nullptr if the queue
+// is full
+template <typename T>
+typename MpmcQueue<T>::Slot* MpmcQueue<T>::claim_push() {
+  size_t position = tail.load(std::memory_order_relaxed);
+  while (true) {
+    Slot *slot = &slots[position & mask];
+    size_t sequence = slot->sequence.load(std::memory_order_acquire);
+    // Signed, as positions wrap
+    ptrdiff_t turn = static_cast<ptrdiff_t>(sequence - position);
+    if (turn == 0) {
+      if (tail.compare_exchange_weak(position, position + 1,
+        std::memory_order_relaxed)) {
+        return slot;
+      }
+    } else if (turn < 0) {
+      // The slot still holds the item from one lap ago
+      return nullptr;
+    } else {
+      position = tail.load(std::memory_order_relaxed);
+    }
+  }
+}
+
+// Claim the slot at the head for a pop, or return nullptr if the queue is
+// empty
+template <typename T>
+typename MpmcQueue<T>::Slot* MpmcQueue<T>::claim_pop() {
+  size_t position = head.load(std::memory_order_relaxed);
+  while (true) {
+    Slot *slot = &slots[position & mask];
+    size_t sequence = slot->sequence.load(std::memory_order_acquire);
+    ptrdiff_t turn = static_cast<ptrdiff_t>(sequence - (position + 1));
+    if (turn == 0) {
+      if (head.compare_exchange_weak(position, position + 1,
+        std::memory_order_relaxed)) {
+        return slot;
+      }
+    } else if (turn < 0) {
+      return nullptr;
+    } else {
+      position = head.load(std::memory_order_relaxed);
+    }
+  }
+}
+
+// Spin briefly, then give the CPU away
+template <typename T>
+void MpmcQueue<T>::backoff(int *spins) {
+  if (++*spins > 64) {
+    std::this_thread::yield();
+  }
+}
+
+// If the constructor throws, consumers stall at the slot (see above)
+template <typename T>
+template <typename... Args>
+bool MpmcQueue<T>::TryEmplace(Args&&... args) {
+  Slot *slot = claim_push();
+  if (!slot) {
+    return false;
+  }
+  size_t position = slot->sequence.load(std::memory_order_relaxed);
+  new (slot->item()) T(std::forward<Args>(args)...);
+  slot->sequence.store(position + 1, std::memory_order_release);
+  return true;
+}
+
+template <typename T>
+bool MpmcQueue<T>::TryPush(const T &value) {
+  return TryEmplace(value);
+}
+
+template <typename T>
+bool MpmcQueue<T>::TryPush(T &&value) {
+  return TryEmplace(std::move(value));
+}
+
+// If the move throws, producers stall at the slot a lap later (see above)
+template <typename T>
+bool MpmcQueue<T>::TryPop(T &out) {
+  Slot *slot = claim_pop();
+  if (!slot) {
+    return false;
+  }
+  // The slot is ours until its sequence moves on a lap
+  size_t position = slot->sequence.load(std::memory_order_relaxed) - 1;
+  out = std::move(*slot->item());
+  slot->item()->~T();
+  slot->sequence.store(position + mask + 1, std::memory_order_release);
+  return true;
+}
+
+template <typename T>
+void MpmcQueue<T>::Push(const T &value) {
+  int spins = 0;
+  while (!TryPush(value)) {
+    backoff(&spins);
+  }
+}
+
+template <typename T>
+void MpmcQueue<T>::Push(T &&value) {
+  int spins = 0;
+  // TryPush only moves from @value once it has a slot
+  while (!TryPush(std::move(value))) {
+    backoff(&spins);
+  }
+}
+
+template <typename T>
+T MpmcQueue<T>::Pop() {
+  int spins = 0;
+  Slot *slot;
+  while (!(slot = claim_pop())) {
+    backoff(&spins);
+  }
+  size_t position = slot->sequence.load(std::memory_order_relaxed) - 1;
+  T value(std::move(*slot->item()));
+  slot->item()->~T();
+  slot->sequence.store(position + mask + 1, std::memory_order_release);
+  return value;
+}
+
+#endif  // MPMC_QUEUE_H_
@@ -0,0 +1,340 @@
+#ifndef PERSISTENT_DEQUE_H_
+#define PERSISTENT_DEQUE_H_
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <type_traits>
+
+// Deque kept in a memory-mapped file, so its contents survive a restart
+// of the process. The file is a one-page header holding the capacity and
+// the logical head and tail, followed by a power-of-two ring of items laid
+// out like Deque's: position p lives in slot p & (capacity - 1). Opening
+// an existing file only checks the header and maps it, so it takes O(1)
+// whatever the deque holds.
+//
+// Every change is made in the shared mapping, so it is in the file as
+// soon as the call returns and outlives a crash of the process; Sync()
+// also makes it outlive a crash of the machine. A push writes the item
+// before it moves head or tail, and growing copies items into the new half
+// of the ring before the header records the new capacity, so the file is
+// consistent after a crash at any point.
+//
+// Items are stored as bytes, so T must be trivially copyable. Growth uses
+// mremap, which is Linux-specific.
+template<typename T>
+class PersistentDeque {
+ public:
+  // Bytes before the items; a page, so the items are page-aligned
+  static const size_t kHeaderSize = 4096;
+
+  // Constructor, opens the deque stored at @path, or creates it there
+  // with room for @capacity items (rounded up to a power of two) if the
+  // file does not exist or is empty; throws std::invalid_argument if
+  // @capacity is too large to map, std::runtime_error if the file holds
+  // something else, or items of another size
+  explicit PersistentDeque(const std::string &path, size_t capacity = 1024);
+  // Destructor, unmaps and closes the file without syncing it
+  ~PersistentDeque();
+
+
+  //
+  // Capacity
+  //
+
+  // Return true if empty, false otherwise
+  // Complexity: O(1)
+  bool Empty() const noexcept;
+  // Return number of items in deque
+  // Complexity: O(1)
+  size_t Size() const noexcept;
+  // Return number of items the file holds before it has to grow
+  // Complexity: O(1)
+  size_t Capacity() const noexcept;
+
+
+  //
+  // Element access
+  //
+
+  // Return item at pos @pos
+  // Complexity: O(1)
+  T& operator[](size_t pos);
+  // Return item at front of deque
+  // Complexity: O(1)
+  T& Front();
+  // Return item at back of deque
+  // Complexity: O(1)
+  T& Back();
+
+
+  //
+  // Modifiers
+  //
+
+  // Clear contents of deque (make it empty); the file keeps its size
+  // Complexity: O(1)
+  void Clear() noexcept;
+  // Push item @value at front of deque
+  // Complexity: O(1) amortized
+  void PushFront(const T &value);
+  // Push item @value at back of deque
+  // Complexity: O(1) amortized
+  void PushBack(const T &value);
+  // Remove item at front of deque
+  // Complexity: O(1)
+  void PopFront();
+  // Remove item at back of deque
+  // Complexity: O(1)
+  void PopBack();
+  // Block until the whole file is on disk
+  // Complexity: O(pages changed since the last Sync)
+  void Sync();
+
+ private:
+    struct Header {
+      uint64_t magic;
+      uint64_t item_size;
+      uint64_t capacity;
+      // Logical positions, as in Deque
+      uint64_t head, tail;
+    };
+    static const uint64_t kMagic = 0x4551454450534550ull;
+    int fd;
+    // The whole file: header, then the items
+    char *map;
+    size_t map_size;
+
+    Header* header() const noexcept;
+    T* items() const noexcept;
+    T& at(uint64_t position) const noexcept;
+    void grow();
+
+    // The mapping is owned, so a PersistentDeque is not copyable
+    PersistentDeque(const PersistentDeque&) = delete;
+    PersistentDeque& operator=(const PersistentDeque&) = delete;
+};
+
+template <typename T>
+const size_t PersistentDeque<T>::kHeaderSize;
+
+template <typename T>
+const uint64_t PersistentDeque<T>::kMagic;
+
+template <typename T>
+PersistentDeque<T>::PersistentDeque(const std::string &path,
+  size_t capacity) : fd(-1), map(nullptr), map_size(0) {
+  static_assert(std::is_trivially_copyable<T>::value,
+    "PersistentDeque items must be trivially copyable");
+  static_assert(alignof(T) <= kHeaderSize,
+    "PersistentDeque does not support over-aligned types");
+  // Rounded up to a power of two, the ring and header must still fit
+  if (capacity > (static_cast<size_t>(-1) - kHeaderSize) / sizeof(T) / 2) {
+    throw std::invalid_argument("Invalid capacity");
+  }
+  fd = open(path.c_str(), O_RDWR | O_CREAT, 0644);
+  if (fd < 0) {
+    throw std::system_error(errno, std::generic_category(), path);
+  }
+  try {
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+      throw std::system_error(errno, std::generic_category(), "fstat");
+    }
+    bool fresh = st.st_size == 0;
+    if (fresh) {
+      size_t size = 1;
+      while (size < capacity) {
+        size *= 2;
+      }
+      map_size = kHeaderSize + size * sizeof(T);
+      if (ftruncate(fd, map_size) != 0) {
+        throw std::system_error(errno, std::generic_category(), "ftruncate");
+      }
+    } else {
+      map_size = st.st_size;
+      if (map_size < kHeaderSize) {
+        throw std::runtime_error("Not a PersistentDeque file");
+      }
+    }
+    void *p = mmap(nullptr, map_size, PROT_READ | PROT_WRITE, MAP_SHARED,
+      fd, 0);
+    if (p == MAP_FAILED) {
+      throw std::system_error(errno, std::generic_category(), "mmap");
+    }
+    map = static_cast<char*>(p);
+    Header *h = header();
+    if (fresh) {
+      h->item_size = sizeof(T);
+      h->capacity = (map_size - kHeaderSize) / sizeof(T);
+      h->head = 0;
+      h->tail = 0;
+      // Written last, so a half-made file is not taken for a deque
+      h->magic = kMagic;
+    } else if (h->magic != kMagic) {
+      throw std::runtime_error("Not a PersistentDeque file");
+    } else if (h->item_size != sizeof(T)) {
+      throw std::runtime_error("PersistentDeque item size mismatch");
+    } else if (h->capacity == 0 || (h->capacity & (h->capacity - 1)) ||
+      h->capacity > (map_size - kHeaderSize) / sizeof(T) ||
+      h->tail - h->head > h->capacity) {
+      throw std::runtime_error("Corrupt PersistentDeque header");
+    }
+  } catch (...) {
+    if (map) {
+      munmap(map, map_size);
+    }
+    close(fd);
+    throw;
+  }
+}
+
+template <typename T>
+PersistentDeque<T>::~PersistentDeque() {
+  munmap(map, map_size);
+  close(fd);
+}
+
+template <typename T>
+typename PersistentDeque<T>::Header* PersistentDeque<T>::header() const
+  noexcept {
+  return reinterpret_cast<Header*>(map);
+}
+
+template <typename T>
+T* PersistentDeque<T>::items() const noexcept {
+  return reinterpret_cast<T*>(map + kHeaderSize);
+}
+
+template <typename T>
+T& PersistentDeque<T>::at(uint64_t position) const noexcept {
+  return items()[position & (header()->capacity - 1)];
+}
+
+template <typename T>
+bool PersistentDeque<T>::Empty() const noexcept {
+  return header()->head == header()->tail;
+}
+
+template <typename T>
+size_t PersistentDeque<T>::Size() const noexcept {
+  return header()->tail - header()->head;
+}
+
+template <typename T>
+size_t PersistentDeque<T>::Capacity() const noexcept {
+  return header()->capacity;
+}
+
+template <typename T>
+T& PersistentDeque<T>::operator[](size_t pos) {
+  if (pos < Size()) {
+    return at(header()->head + pos);
+  } else {
+    throw std::out_of_range("Incorrect Index");
+  }
+}
+
+template <typename T>
+T& PersistentDeque<T>::Front() {
+  if (!Empty()) {
+    return at(header()->head);
+  } else {
+    throw std::out_of_range("No front available");
+  }
+}
+
+template <typename T>
+T& PersistentDeque<T>::Back() {
+  if (!Empty()) {
+    return at(header()->tail - 1);
+  } else {
+    throw std::out_of_range("No back available");
+  }
+}
+
+template <typename T>
+void PersistentDeque<T>::Clear() noexcept {
+  header()->head = header()->tail;
+}
+
+// Double the ring. Position p moves from slot p & (c - 1) to p & (2c - 1),
+// which is either the same slot or the one c further on, in the new half;
+// items are copied there, so the old layout stays intact until the header
+// switches to the new capacity
+template <typename T>
+void PersistentDeque<T>::grow() {
+  uint64_t capacity = header()->capacity;
+  size_t new_map_size = kHeaderSize + 2 * capacity * sizeof(T);
+  if (new_map_size > map_size) {
+    if (ftruncate(fd, new_map_size) != 0) {
+      throw std::system_error(errno, std::generic_category(), "ftruncate");
+    }
+    void *p = mremap(map, map_size, new_map_size, MREMAP_MAYMOVE);
+    if (p == MAP_FAILED) {
+      throw std::system_error(errno, std::generic_category(), "mremap");
+    }
+    map = static_cast<char*>(p);
+    map_size = new_map_size;
+  }
+  Header *h = header();
+  T *slots = items();
+  for (uint64_t p = h->head; p != h->tail; p++) {
+    if (p & capacity) {
+      memcpy(slots + (p & (capacity - 1)) + capacity,
+        slots + (p & (capacity - 1)), sizeof(T));
+    }
+  }
+  h->capacity = 2 * capacity;
+}
+
+template <typename T>
+void PersistentDeque<T>::PushFront(const T &value) {
+  if (Size() == Capacity()) {
+    grow();
+  }
+  memcpy(&at(header()->head - 1), &value, sizeof(T));
+  header()->head--;
+}
+
+template <typename T>
+void PersistentDeque<T>::PushBack(const T &value) {
+  if (Size() == Capacity()) {
+    grow();
+  }
+  memcpy(&at(header()->tail), &value, sizeof(T));
+  header()->tail++;
+}
+
+template <typename T>
+void PersistentDeque<T>::PopFront() {
+  if (Empty()) {
+    throw std::out_of_range("Deque has no values");
+  }
+  header()->head++;
+}
+
+template <typename T>
+void PersistentDeque<T>::PopBack() {
+  if (Empty()) {
+    throw std::out_of_range("Deque has no values");
+  }
+  header()->tail--;
+}
+
+template <typename T>
+void PersistentDeque<T>::Sync() {
+  if (msync(map, map_size, MS_SYNC) != 0) {
+    throw std::system_error(errno, std::generic_category(), "msync");
+  }
+}
+
+#endif  // PERSISTENT_DEQUE_H_
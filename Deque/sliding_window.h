@@ -0,0 +1,265 @@
+#ifndef SLIDING_WINDOW_H_
+#define SLIDING_WINDOW_H_
+
+#include <cstddef>
+#include <functional>
+#include <stdexcept>
+#include <utility>
+#include "deque.h"
+
+// Minimum (or maximum, or any Compare-best value) of the last @window
+// samples, in amortized O(1) per sample. It is a monotonic deque: it keeps
+// only the samples that can still be the best, in arrival order, which
+// makes them ordered by Compare too. A new sample first removes from the
+// back every sample it beats, as they leave the window before it and so
+// can never be the answer again, and samples that have slid out of the
+// window are removed from the front; the front is then the answer. Each
+// sample is pushed and popped at most once.
+template<typename T, typename Compare = std::less<T>>
+class MonotonicWindow {
+ public:
+  // Constructor, over the last @window (at least 1) samples
+  explicit MonotonicWindow(size_t window, const Compare &compare = Compare());
+
+
+  //
+  // Capacity
+  //
+
+  // Return true if no sample was pushed since construction or Clear()
+  // Complexity: O(1)
+  bool Empty() const noexcept;
+  // Return number of samples in the window, at most @window
+  // Complexity: O(1)
+  size_t Size() const noexcept;
+
+
+  //
+  // Element access
+  //
+
+  // Return the best sample in the window, the earliest of equal ones
+  // Complexity: O(1)
+  const T& Best() const;
+
+
+  //
+  // Modifiers
+  //
+
+  // Forget every sample
+  // Complexity: O(window)
+  void Clear() noexcept;
+  // Add sample @value, dropping the oldest sample once the window is full
+  // Complexity: O(1) amortized
+  void Push(const T &value);
+
+ private:
+    struct Entry {
+      size_t index;
+      T value;
+    };
+    // Candidates, ordered by index and by Compare
+    Deque<Entry> candidates;
+    size_t window;
+    // Samples pushed so far, the index of the next one
+    size_t pushed;
+    Compare compare;
+};
+
+// Sliding minimum and maximum of the last @window samples
+template <typename T>
+using SlidingMin = MonotonicWindow<T, std::less<T>>;
+template <typename T>
+using SlidingMax = MonotonicWindow<T, std::greater<T>>;
+
+template <typename T, typename Compare>
+MonotonicWindow<T, Compare>::MonotonicWindow(size_t window,
+  const Compare &compare) : window(window), pushed(0), compare(compare) {
+  if (window == 0) {
+    throw std::invalid_argument("Invalid window");
+  }
+}
+
+template <typename T, typename Compare>
+bool MonotonicWindow<T, Compare>::Empty() const noexcept {
+  return pushed == 0;
+}
+
+template <typename T, typename Compare>
+size_t MonotonicWindow<T, Compare>::Size() const noexcept {
+  return pushed < window ? pushed : window;
+}
+
+template <typename T, typename Compare>
+const T& MonotonicWindow<T, Compare>::Best() const {
+  if (Empty()) {
+    throw std::out_of_range("Window has no samples");
+  }
+  return const_cast<Deque<Entry>&>(candidates).Front().value;
+}
+
+template <typename T, typename Compare>
+void MonotonicWindow<T, Compare>::Clear() noexcept {
+  candidates.Clear();
+  pushed = 0;
+}
+
+// Equal samples stay, so the earliest of them remains the answer
+template <typename T, typename Compare>
+void MonotonicWindow<T, Compare>::Push(const T &value) {
+  while (!candidates.Empty() && compare(value, candidates.Back().value)) {
+    candidates.PopBack();
+  }
+  candidates.PushBack(Entry{pushed, value});
+  pushed++;
+  if (candidates.Front().index + window < pushed) {
+    candidates.PopFront();
+  }
+}
+
+// Fold with @Op, any associative operation (sum, min, gcd, matrix
+// product...), of the last @window samples, in amortized O(1) per sample
+// and without an inverse of @Op. This is the two-stack queue: samples
+// arrive on the back stack, which only keeps the fold of all its samples,
+// and leave from the front stack, which keeps for each sample the fold of
+// it and every later front sample, so Query() combines two values. When
+// the front stack runs out, the back one is flipped into it with one pass
+// from the newest sample to the oldest, which each sample goes through
+// once.
+template<typename T, typename Op>
+class SlidingAggregate {
+ public:
+  // Constructor, over the last @window (at least 1) samples
+  explicit SlidingAggregate(size_t window, const Op &op = Op());
+
+
+  //
+  // Capacity
+  //
+
+  // Return true if the window has no samples
+  // Complexity: O(1)
+  bool Empty() const noexcept;
+  // Return number of samples in the window, at most @window
+  // Complexity: O(1)
+  size_t Size() const noexcept;
+
+
+  //
+  // Element access
+  //
+
+  // Return the fold of the samples in the window, oldest first
+  // Complexity: O(1)
+  T Query() const;
+
+
+  //
+  // Modifiers
+  //
+
+  // Forget every sample
+  // Complexity: O(window)
+  void Clear() noexcept;
+  // Add sample @value, dropping the oldest sample once the window is full
+  // Complexity: O(1) amortized
+  void Push(const T &value);
+  // Drop the oldest sample, for windows kept by time rather than count
+  // Complexity: O(1) amortized
+  void Pop();
+
+ private:
+    // Every sample in the window, oldest first
+    Deque<T> samples;
+    // Folds for the oldest front.Size() samples: front[i] is the fold of
+    // samples[i] up to samples[front.Size() - 1]
+    Deque<T> front;
+    // Fold of the remaining, newer samples, if there are any
+    T back;
+    size_t window;
+    Op op;
+
+    void flip();
+};
+
+template <typename T, typename Op>
+SlidingAggregate<T, Op>::SlidingAggregate(size_t window, const Op &op)
+  : back(), window(window), op(op) {
+  if (window == 0) {
+    throw std::invalid_argument("Invalid window");
+  }
+}
+
+template <typename T, typename Op>
+bool SlidingAggregate<T, Op>::Empty() const noexcept {
+  return samples.Empty();
+}
+
+template <typename T, typename Op>
+size_t SlidingAggregate<T, Op>::Size() const noexcept {
+  return samples.Size();
+}
+
+template <typename T, typename Op>
+T SlidingAggregate<T, Op>::Query() const {
+  if (Empty()) {
+    throw std::out_of_range("Window has no samples");
+  }
+  Deque<T> &f = const_cast<Deque<T>&>(front);
+  if (f.Empty()) {
+    return back;
+  }
+  if (f.Size() == samples.Size()) {
+    return f.Front();
+  }
+  return op(f.Front(), back);
+}
+
+template <typename T, typename Op>
+void SlidingAggregate<T, Op>::Clear() noexcept {
+  samples.Clear();
+  front.Clear();
+}
+
+template <typename T, typename Op>
+void SlidingAggregate<T, Op>::Push(const T &value) {
+  if (samples.Size() == window) {
+    Pop();
+  }
+  back = samples.Size() == front.Size() ? value : op(back, value);
+  samples.PushBack(value);
+}
+
+template <typename T, typename Op>
+void SlidingAggregate<T, Op>::Pop() {
+  if (Empty()) {
+    throw std::out_of_range("Window has no samples");
+  }
+  if (front.Empty()) {
+    flip();
+  }
+  samples.PopFront();
+  front.PopFront();
+}
+
+// Move every sample onto the front stack, folding from the newest; if
+// @op throws, the front stack is left empty again
+template <typename T, typename Op>
+void SlidingAggregate<T, Op>::flip() {
+  front.Reserve(samples.Size());
+  try {
+    auto it = samples.end();
+    T fold = *--it;
+    front.PushFront(fold);
+    while (it != samples.begin()) {
+      fold = op(*--it, fold);
+      front.PushFront(fold);
+    }
+  } catch (...) {
+    front.Clear();
+    throw;
+  }
+}
+
+#endif  // SLIDING_WINDOW_H_
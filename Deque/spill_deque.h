@@ -0,0 +1,442 @@
+#ifndef SPILL_DEQUE_H_
+#define SPILL_DEQUE_H_
+
+#include <unistd.h>
+#include <cerrno>
+#include <cstddef>
+#include <cstdio>
+#include <new>
+#include <stdexcept>
+#include <system_error>
+#include <type_traits>
+#include <vector>
+#include "deque.h"
+
+// Deque that keeps at most a fixed number of segments of items in memory
+// and spills the rest to a temporary file, for queues that may outgrow
+// RAM. Items live in segments of @segment_items; a Deque of segments keeps
+// their order. The front and back segments are always brought back into
+// memory before they are used, so pushes and pops at either end work on
+// memory; when a new segment would exceed the budget, an interior segment
+// is written out whole, starting from the end being pushed at, which in a
+// queue is the one needed last. Spilled segments come back one at a time
+// as the ends reach them, so the file is written and read in segment-sized
+// sequential runs. File slots are reused through a free list.
+//
+// Items are written to and read from the file as bytes, so T must be
+// trivially copyable. There is no random access, as it would mean I/O.
+template<typename T>
+class SpillDeque {
+ public:
+  // Default items per segment, 64 KiB worth
+  static const size_t kSegmentBytes = 64 * 1024;
+
+  // Constructor, keeps at most @memory_segments (at least 2) segments of
+  // @segment_items items in memory
+  explicit SpillDeque(size_t memory_segments = 16,
+    size_t segment_items = kSegmentBytes / sizeof(T));
+  // Destructor, closes and so deletes the file
+  ~SpillDeque();
+
+
+  //
+  // Capacity
+  //
+
+  // Return true if empty, false otherwise
+  // Complexity: O(1)
+  bool Empty() const noexcept;
+  // Return number of items in deque
+  // Complexity: O(1)
+  size_t Size() const noexcept;
+  // Return number of segments in memory
+  // Complexity: O(1)
+  size_t MemorySegments() const noexcept;
+  // Return number of segments in the file
+  // Complexity: O(1)
+  size_t SpilledSegments() const noexcept;
+
+
+  //
+  // Element access
+  //
+
+  // Return item at front of deque
+  // Complexity: O(1), plus reading one segment if it was spilled
+  T& Front();
+  // Return item at back of deque
+  // Complexity: O(1), plus reading one segment if it was spilled
+  T& Back();
+
+
+  //
+  // Modifiers
+  //
+
+  // Remove every item and free every segment; the file is truncated
+  // Complexity: O(segments)
+  void Clear() noexcept;
+  // Push item @value at front of deque
+  // Complexity: O(1), plus writing one segment when a new one is needed
+  void PushFront(const T &value);
+  // Push item @value at back of deque
+  // Complexity: O(1), plus writing one segment when a new one is needed
+  void PushBack(const T &value);
+  // Remove item at front of deque
+  // Complexity: O(1), plus reading one segment if it was spilled
+  void PopFront();
+  // Remove item at back of deque
+  // Complexity: O(1), plus reading one segment if it was spilled
+  void PopBack();
+
+ private:
+    // Items [first, last) of @items are in use; while the segment is
+    // spilled @items is nullptr and they are at @slot in the file, at the
+    // same offsets
+    struct Segment {
+      T *items;
+      off_t slot;
+      size_t first, last;
+    };
+    Deque<Segment> segments;
+    size_t memory_segments, segment_items;
+    size_t count;
+    size_t in_memory, spilled;
+    // Emptied buffers kept for the next segment
+    std::vector<T*> spare;
+    FILE *file;
+    // Slots freed by loaded segments, and the end of the file
+    std::vector<off_t> free_slots;
+    off_t file_end;
+
+    T* take_buffer();
+    void release_buffer(T *items) noexcept;
+    off_t take_slot();
+    void add_segment(bool front);
+    Segment& front_segment();
+    Segment& back_segment();
+    void spill(Segment &s);
+    void load(Segment &s, bool front);
+    void spill_one(bool near_front);
+    void drop_front();
+    void drop_back();
+
+    // The file and buffers are owned, so a SpillDeque is not copyable
+    SpillDeque(const SpillDeque&) = delete;
+    SpillDeque& operator=(const SpillDeque&) = delete;
+};
+
+template <typename T>
+const size_t SpillDeque<T>::kSegmentBytes;
+
+template <typename T>
+SpillDeque<T>::SpillDeque(size_t memory_segments, size_t segment_items)
+  : memory_segments(memory_segments), segment_items(segment_items),
+  count(0), in_memory(0), spilled(0), file(nullptr), file_end(0) {
+  static_assert(std::is_trivially_copyable<T>::value,
+    "SpillDeque items must be trivially copyable");
+  static_assert(alignof(T) <= alignof(std::max_align_t),
+    "SpillDeque does not support over-aligned types");
+  if (memory_segments < 2 || segment_items == 0) {
+    throw std::invalid_argument("Invalid segment sizes");
+  }
+}
+
+template <typename T>
+SpillDeque<T>::~SpillDeque() {
+  Clear();
+  for (T *b : spare) {
+    ::operator delete(b);
+  }
+  if (file) {
+    fclose(file);
+  }
+}
+
+template <typename T>
+bool SpillDeque<T>::Empty() const noexcept {
+  return count == 0;
+}
+
+template <typename T>
+size_t SpillDeque<T>::Size() const noexcept {
+  return count;
+}
+
+template <typename T>
+size_t SpillDeque<T>::MemorySegments() const noexcept {
+  return in_memory;
+}
+
+template <typename T>
+size_t SpillDeque<T>::SpilledSegments() const noexcept {
+  return spilled;
+}
+
+template <typename T>
+T& SpillDeque<T>::Front() {
+  if (Empty()) {
+    throw std::out_of_range("No front available");
+  }
+  Segment &s = front_segment();
+  return s.items[s.first];
+}
+
+template <typename T>
+T& SpillDeque<T>::Back() {
+  if (Empty()) {
+    throw std::out_of_range("No back available");
+  }
+  Segment &s = back_segment();
+  return s.items[s.last - 1];
+}
+
+template <typename T>
+void SpillDeque<T>::Clear() noexcept {
+  while (!segments.Empty()) {
+    release_buffer(segments.Front().items);
+    segments.PopFront();
+  }
+  count = 0;
+  in_memory = 0;
+  spilled = 0;
+  free_slots.clear();
+  file_end = 0;
+  // If this fails the file only stays larger than it needs to be
+  if (file && ftruncate(fileno(file), 0) != 0) {
+    errno = 0;
+  }
+}
+
+template <typename T>
+T* SpillDeque<T>::take_buffer() {
+  if (!spare.empty()) {
+    T *b = spare.back();
+    spare.pop_back();
+    return b;
+  }
+  return static_cast<T*>(::operator new(segment_items * sizeof(T)));
+}
+
+// @items may be nullptr, for a spilled segment
+template <typename T>
+void SpillDeque<T>::release_buffer(T *items) noexcept {
+  if (items && spare.size() < 2) {
+    try {
+      spare.push_back(items);
+      return;
+    } catch (...) {
+    }
+  }
+  ::operator delete(items);
+}
+
+// A file slot for one segment, creating the file on the first spill
+template <typename T>
+off_t SpillDeque<T>::take_slot() {
+  if (!file) {
+    file = tmpfile();
+    if (!file) {
+      throw std::system_error(errno, std::generic_category(), "tmpfile");
+    }
+  }
+  if (!free_slots.empty()) {
+    off_t slot = free_slots.back();
+    free_slots.pop_back();
+    return slot;
+  }
+  off_t slot = file_end;
+  file_end += segment_items * sizeof(T);
+  return slot;
+}
+
+// Write the items of in-memory @s to the file and free its buffer
+template <typename T>
+void SpillDeque<T>::spill(Segment &s) {
+  off_t slot = take_slot();
+  const char *data = reinterpret_cast<const char*>(s.items + s.first);
+  size_t bytes = (s.last - s.first) * sizeof(T);
+  off_t offset = slot + s.first * sizeof(T);
+  while (bytes > 0) {
+    ssize_t n = pwrite(fileno(file), data, bytes, offset);
+    if (n <= 0 && !(n < 0 && errno == EINTR)) {
+      // A write that makes no progress would otherwise loop forever
+      int error = n < 0 ? errno : EIO;
+      free_slots.push_back(slot);
+      throw std::system_error(error, std::generic_category(), "pwrite");
+    }
+    if (n > 0) {
+      data += n;
+      bytes -= n;
+      offset += n;
+    }
+  }
+  release_buffer(s.items);
+  s.items = nullptr;
+  s.slot = slot;
+  in_memory--;
+  spilled++;
+}
+
+// Read spilled @s, now at the front or back, back into memory; that may
+// push another segment out
+template <typename T>
+void SpillDeque<T>::load(Segment &s, bool front) {
+  T *items = take_buffer();
+  char *data = reinterpret_cast<char*>(items + s.first);
+  size_t bytes = (s.last - s.first) * sizeof(T);
+  off_t offset = s.slot + s.first * sizeof(T);
+  while (bytes > 0) {
+    ssize_t n = pread(fileno(file), data, bytes, offset);
+    if (n <= 0 && !(n < 0 && errno == EINTR)) {
+      int error = n < 0 ? errno : EIO;
+      release_buffer(items);
+      throw std::system_error(error, std::generic_category(), "pread");
+    }
+    if (n > 0) {
+      data += n;
+      bytes -= n;
+      offset += n;
+    }
+  }
+  try {
+    free_slots.push_back(s.slot);
+  } catch (...) {
+    release_buffer(items);
+    throw;
+  }
+  s.items = items;
+  s.slot = -1;
+  spilled--;
+  in_memory++;
+  if (in_memory > memory_segments) {
+    spill_one(!front);
+  }
+}
+
+// Spill the in-memory interior segment nearest the front or the back
+template <typename T>
+void SpillDeque<T>::spill_one(bool near_front) {
+  size_t n = segments.Size();
+  for (size_t i = 1; i + 1 < n; i++) {
+    Segment &s = segments[near_front ? i : n - 1 - i];
+    if (s.items) {
+      spill(s);
+      return;
+    }
+  }
+}
+
+// Start a new, empty segment at the front or back
+template <typename T>
+void SpillDeque<T>::add_segment(bool front) {
+  Segment s;
+  s.items = take_buffer();
+  s.slot = -1;
+  // Items go toward the middle of the deque from the new end
+  s.first = s.last = front ? segment_items : 0;
+  try {
+    if (front) {
+      segments.PushFront(s);
+    } else {
+      segments.PushBack(s);
+    }
+  } catch (...) {
+    release_buffer(s.items);
+    throw;
+  }
+  in_memory++;
+  if (in_memory > memory_segments) {
+    try {
+      spill_one(front);
+    } catch (...) {
+      front ? segments.PopFront() : segments.PopBack();
+      release_buffer(s.items);
+      in_memory--;
+      throw;
+    }
+  }
+}
+
+template <typename T>
+typename SpillDeque<T>::Segment& SpillDeque<T>::front_segment() {
+  Segment &s = segments.Front();
+  if (!s.items) {
+    load(s, true);
+  }
+  return s;
+}
+
+template <typename T>
+typename SpillDeque<T>::Segment& SpillDeque<T>::back_segment() {
+  Segment &s = segments.Back();
+  if (!s.items) {
+    load(s, false);
+  }
+  return s;
+}
+
+template <typename T>
+void SpillDeque<T>::PushFront(const T &value) {
+  if (segments.Empty() || front_segment().first == 0) {
+    add_segment(true);
+  }
+  Segment &s = segments.Front();
+  s.first--;
+  new (s.items + s.first) T(value);
+  count++;
+}
+
+template <typename T>
+void SpillDeque<T>::PushBack(const T &value) {
+  if (segments.Empty() || back_segment().last == segment_items) {
+    add_segment(false);
+  }
+  Segment &s = segments.Back();
+  new (s.items + s.last) T(value);
+  s.last++;
+  count++;
+}
+
+// The front segment has no items left
+template <typename T>
+void SpillDeque<T>::drop_front() {
+  release_buffer(segments.Front().items);
+  in_memory--;
+  segments.PopFront();
+}
+
+template <typename T>
+void SpillDeque<T>::drop_back() {
+  release_buffer(segments.Back().items);
+  in_memory--;
+  segments.PopBack();
+}
+
+template <typename T>
+void SpillDeque<T>::PopFront() {
+  if (Empty()) {
+    throw std::out_of_range("Deque has no values");
+  }
+  Segment &s = front_segment();
+  s.first++;
+  count--;
+  if (s.first == s.last) {
+    drop_front();
+  }
+}
+
+template <typename T>
+void SpillDeque<T>::PopBack() {
+  if (Empty()) {
+    throw std::out_of_range("Deque has no values");
+  }
+  Segment &s = back_segment();
+  s.last--;
+  count--;
+  if (s.first == s.last) {
+    drop_back();
+  }
+}
+
+#endif  // SPILL_DEQUE_H_
@@ -0,0 +1,260 @@
+#ifndef SPSC_QUEUE_H_
+#define SPSC_QUEUE_H_
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <new>
+#include <stdexcept>
+#include <utility>
+
+// Bounded lock-free queue for exactly one producer thread and one consumer
+// thread, laid out like Deque: a power-of-two ring of raw slots reached
+// through logical head and tail counters masked by capacity - 1. Only the
+// producer writes tail and only the consumer writes head; each side keeps
+// a private copy of the other's counter and reloads it only when the queue
+// looks full (or empty), so most operations touch no shared cache line but
+// their own. Batch operations publish many items with a single store.
+template<typename T>
+class SpscQueue {
+ public:
+  // Assumed cache line size; head and tail live this far apart
+  static const size_t kCacheLine = 64;
+
+  // Constructor, room for at least @capacity items (rounded up to a power
+  // of two)
+  explicit SpscQueue(size_t capacity);
+  // Destructor, destroys the items still queued; no thread may be using
+  // the queue
+  ~SpscQueue();
+
+
+  //
+  // Capacity
+  //
+
+  // Return the number of items the queue holds when full
+  // Complexity: O(1)
+  size_t Capacity() const noexcept;
+  // Return number of items queued; exact only when neither side is
+  // running, otherwise a snapshot
+  // Complexity: O(1)
+  size_t Size() const noexcept;
+  // Return true if Size() is 0
+  // Complexity: O(1)
+  bool Empty() const noexcept;
+
+
+  //
+  // Producer side
+  //
+
+  // Push item @value at back of queue, return false if it is full
+  // Complexity: O(1)
+  bool TryPush(const T &value);
+  bool TryPush(T &&value);
+  // Construct an item from @args at back of queue, return false if it is
+  // full
+  // Complexity: O(1)
+  template <typename... Args>
+  bool TryEmplace(Args&&... args);
+  // Push copies of up to @n items at @items, in order, return how many
+  // fitted; they become visible to the consumer together
+  // Complexity: O(n)
+  size_t PushBatch(const T *items, size_t n);
+
+
+  //
+  // Consumer side
+  //
+
+  // Move the front item into @out and remove it, return false if the
+  // queue is empty
+  // Complexity: O(1)
+  bool TryPop(T &out);
+  // Move up to @n items from front of queue into @out, in order, remove
+  // them and return how many there were
+  // Complexity: O(n)
+  size_t PopBatch(T *out, size_t n);
+
+ private:
+    // Padding keeps the read-only fields, the consumer's counter and the
+    // producer's counter on separate cache lines, so the two threads do
+    // not invalidate each other's line on every operation
+    struct Counter {
+      std::atomic<size_t> value;
+      // The other side's counter as last seen
+      size_t cached;
+      char pad[kCacheLine];
+    };
+    char pad0[kCacheLine];
+    T *array;
+    size_t mask;
+    char pad1[kCacheLine];
+    // Consumer: next item to pop, cached tail
+    Counter head;
+    // Producer: next slot to fill, cached head
+    Counter tail;
+
+    size_t free_slots(size_t n);
+    size_t ready_items(size_t n);
+
+    // The queue is shared by two threads by address; it is neither copied
+    // nor moved
+    SpscQueue(const SpscQueue&) = delete;
+    SpscQueue& operator=(const SpscQueue&) = delete;
+};
+
+template <typename T>
+const size_t SpscQueue<T>::kCacheLine;
+
+template <typename T>
+SpscQueue<T>::SpscQueue(size_t capacity) : array(nullptr), mask(0) {
+  static_assert(alignof(T) <= alignof(std::max_align_t),
+    "SpscQueue does not support over-aligned types");
+  if (capacity == 0 ||
+    capacity > (static_cast<size_t>(-1) >> 1) / sizeof(T)) {
+    throw std::invalid_argument("Invalid capacity");
+  }
+  size_t size = 1;
+  while (size < capacity) {
+    size *= 2;
+  }
+  array = static_cast<T*>(::operator new(size * sizeof(T)));
+  mask = size - 1;
+  head.value.store(0, std::memory_order_relaxed);
+  head.cached = 0;
+  tail.value.store(0, std::memory_order_relaxed);
+  tail.cached = 0;
+}
+
+template <typename T>
+SpscQueue<T>::~SpscQueue() {
+  size_t end = tail.value.load(std::memory_order_relaxed);
+  for (size_t i = head.value.load(std::memory_order_relaxed); i != end; i++) {
+    array[i & mask].~T();
+  }
+  ::operator delete(array);
+}
+
+template <typename T>
+size_t SpscQueue<T>::Capacity() const noexcept {
+  return mask + 1;
+}
+
+template <typename T>
+size_t SpscQueue<T>::Size() const noexcept {
+  size_t h = head.value.load(std::memory_order_acquire);
+  size_t t = tail.value.load(std::memory_order_acquire);
+  // Read apart: the head is read first, so the tail is never behind it,
+  // but by the time the tail is read the consumer may have popped and the
+  // producer pushed past that head; the queue was full in between
+  return std::min(t - h, mask + 1);
+}
+
+template <typename T>
+bool SpscQueue<T>::Empty() const noexcept {
+  return Size() == 0;
+}
+
+// Producer: how many of @n slots are free, reloading the consumer's head
+// only when the cached one says there are too few
+template <typename T>
+size_t SpscQueue<T>::free_slots(size_t n) {
+  size_t t = tail.value.load(std::memory_order_relaxed);
+  size_t free = mask + 1 - (t - tail.cached);
+  if (free < n) {
+    tail.cached = head.value.load(std::memory_order_acquire);
+    free = mask + 1 - (t - tail.cached);
+  }
+  return std::min(free, n);
+}
+
+// Consumer: how many of @n items are ready, reloading the producer's tail
+// only when the cached one says there are too few
+template <typename T>
+size_t SpscQueue<T>::ready_items(size_t n) {
+  size_t h = head.value.load(std::memory_order_relaxed);
+  size_t ready = head.cached - h;
+  if (ready < n) {
+    head.cached = tail.value.load(std::memory_order_acquire);
+    ready = head.cached - h;
+  }
+  return std::min(ready, n);
+}
+
+template <typename T>
+template <typename... Args>
+bool SpscQueue<T>::TryEmplace(Args&&... args) {
+  if (free_slots(1) == 0) {
+    return false;
+  }
+  size_t t = tail.value.load(std::memory_order_relaxed);
+  new (array + (t & mask)) T(std::forward<Args>(args)...);
+  tail.value.store(t + 1, std::memory_order_release);
+  return true;
+}
+
+template <typename T>
+bool SpscQueue<T>::TryPush(const T &value) {
+  return TryEmplace(value);
+}
+
+template <typename T>
+bool SpscQueue<T>::TryPush(T &&value) {
+  return TryEmplace(std::move(value));
+}
+
+// If a copy throws, the items copied before it are still published
+template <typename T>
+size_t SpscQueue<T>::PushBatch(const T *items, size_t n) {
+  n = free_slots(n);
+  size_t t = tail.value.load(std::memory_order_relaxed);
+  size_t i = 0;
+  try {
+    for (; i < n; i++) {
+      new (array + ((t + i) & mask)) T(items[i]);
+    }
+  } catch (...) {
+    tail.value.store(t + i, std::memory_order_release);
+    throw;
+  }
+  tail.value.store(t + n, std::memory_order_release);
+  return n;
+}
+
+template <typename T>
+bool SpscQueue<T>::TryPop(T &out) {
+  if (ready_items(1) == 0) {
+    return false;
+  }
+  size_t h = head.value.load(std::memory_order_relaxed);
+  T &item = array[h & mask];
+  out = std::move(item);
+  item.~T();
+  head.value.store(h + 1, std::memory_order_release);
+  return true;
+}
+
+// If a move throws, the items moved out before it are removed and the one
+// that threw stays at the front
+template <typename T>
+size_t SpscQueue<T>::PopBatch(T *out, size_t n) {
+  n = ready_items(n);
+  size_t h = head.value.load(std::memory_order_relaxed);
+  size_t i = 0;
+  try {
+    for (; i < n; i++) {
+      T &item = array[(h + i) & mask];
+      out[i] = std::move(item);
+      item.~T();
+    }
+  } catch (...) {
+    head.value.store(h + i, std::memory_order_release);
+    throw;
+  }
+  head.value.store(h + n, std::memory_order_release);
+  return n;
+}
+
+#endif  // SPSC_QUEUE_H_
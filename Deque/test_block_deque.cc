@@ -0,0 +1,177 @@
+#include "block_deque.h"
+#include <gtest/gtest.h> // NOLINT (build/c++11)
+#include <deque>
+#include <random>
+#include <string>
+#include <vector>
+
+TEST(BlockDeque, Empty) {
+  BlockDeque<int> dq;
+
+  /* Should be fully empty */
+  EXPECT_EQ(dq.Empty(), true);
+  EXPECT_EQ(dq.Size(), 0);
+  EXPECT_THROW(dq.PopFront(), std::out_of_range);
+  EXPECT_THROW(dq.PopBack(), std::out_of_range);
+  EXPECT_THROW(dq.Front(), std::out_of_range);
+  EXPECT_THROW(dq.Back(), std::out_of_range);
+  EXPECT_THROW(dq[0], std::out_of_range);
+}
+
+TEST(BlockDeque, PushBothEnds) {
+  BlockDeque<int> dq;
+  dq.PushBack(23);
+  dq.PushFront(42);
+  dq.PushBack(74);
+  EXPECT_EQ(dq.Size(), 3);
+  EXPECT_EQ(dq[0], 42);
+  EXPECT_EQ(dq[1], 23);
+  EXPECT_EQ(dq[2], 74);
+  EXPECT_EQ(dq.Front(), 42);
+  EXPECT_EQ(dq.Back(), 74);
+  EXPECT_EQ(dq.TakeFront(), 42);
+  EXPECT_EQ(dq.TakeBack(), 74);
+  EXPECT_EQ(dq.Size(), 1);
+}
+
+TEST(BlockDeque, RandomAgainstStdDeque) {
+  BlockDeque<int> dq;
+  std::deque<int> expected;
+  std::mt19937 rng(11);
+  for (int i = 0; i < 200000; i++) {
+    // Drift between growing and draining so blocks keep being recycled
+    bool grow = (i / 20000) % 2 == 0;
+    unsigned int op = rng() % 8;
+    if (op < (grow ? 3u : 2u)) {
+      dq.PushBack(i);
+      expected.push_back(i);
+    } else if (op < (grow ? 6u : 4u)) {
+      dq.PushFront(i);
+      expected.push_front(i);
+    } else if (op < 6 && !expected.empty()) {
+      dq.PopFront();
+      expected.pop_front();
+    } else if (op < 7 && !expected.empty()) {
+      dq.PopBack();
+      expected.pop_back();
+    } else if (op == 7 && !expected.empty()) {
+      size_t pos = rng() % expected.size();
+      ASSERT_EQ(dq[pos], expected[pos]);
+    }
+    ASSERT_EQ(dq.Size(), expected.size());
+    if (i % 50000 == 0) {
+      dq.ShrinkToFit();
+    }
+  }
+  for (size_t i = 0; i < expected.size(); i++) {
+    ASSERT_EQ(dq[i], expected[i]);
+  }
+}
+
+TEST(BlockDeque, ReferencesStayValid) {
+  BlockDeque<int> dq;
+  dq.PushBack(1);
+  dq.PushFront(0);
+  int *front = &dq.Front();
+  int *back = &dq.Back();
+  for (int i = 0; i < 100000; i++) {
+    dq.PushBack(i);
+    dq.PushFront(i);
+  }
+  EXPECT_EQ(front, &dq[100000]);
+  EXPECT_EQ(back, &dq[100001]);
+  EXPECT_EQ(*front, 0);
+  EXPECT_EQ(*back, 1);
+}
+
+TEST(BlockDeque, RecyclesBlocks) {
+  BlockDeque<int> dq;
+  size_t n = BlockDeque<int>::kBlockSize;
+  for (size_t i = 0; i < n; i++) {
+    dq.PushBack(i);
+  }
+  int *first = &dq.Front();
+  // The emptied block is reused by the next push
+  while (!dq.Empty()) {
+    dq.PopFront();
+  }
+  dq.PushFront(7);
+  EXPECT_EQ(&dq.Front() - (n - 1), first);
+  dq.Clear();
+  EXPECT_TRUE(dq.Empty());
+  dq.ShrinkToFit();
+  dq.PushBack(8);
+  EXPECT_EQ(dq.Front(), 8);
+}
+
+// Counts live objects and copies; has no default constructor
+struct Tracked {
+  static int live;
+  static int copies;
+  int value;
+  explicit Tracked(int v) : value(v) { live++; }
+  Tracked(const Tracked &other) : value(other.value) { live++; copies++; }
+  Tracked(Tracked &&other) noexcept : value(other.value) { live++; }
+  Tracked& operator=(const Tracked&) = delete;
+  ~Tracked() { live--; }
+};
+int Tracked::live = 0;
+int Tracked::copies = 0;
+
+TEST(BlockDeque, ConstructsAndDestroysItems) {
+  Tracked::live = 0;
+  Tracked::copies = 0;
+  {
+    BlockDeque<Tracked> dq;
+    for (int i = 0; i < 10000; i++) {
+      dq.EmplaceBack(i);
+      dq.EmplaceFront(-i);
+    }
+    EXPECT_EQ(Tracked::live, 20000);
+    EXPECT_EQ(Tracked::copies, 0);
+    for (int i = 0; i < 15000; i++) {
+      dq.PopFront();
+    }
+    EXPECT_EQ(Tracked::live, 5000);
+    EXPECT_EQ(dq.Front().value, 5000);
+    EXPECT_EQ(dq.Back().value, 9999);
+  }
+  EXPECT_EQ(Tracked::live, 0);
+}
+
+// Throws from its constructor when given a negative value
+struct Picky {
+  explicit Picky(int v) {
+    if (v < 0) {
+      throw std::invalid_argument("negative");
+    }
+  }
+};
+
+TEST(BlockDeque, FailedPushLeavesDequeUnchanged) {
+  BlockDeque<Picky> dq;
+  EXPECT_THROW(dq.EmplaceBack(-1), std::invalid_argument);
+  EXPECT_TRUE(dq.Empty());
+  for (size_t i = 0; i < BlockDeque<Picky>::kBlockSize; i++) {
+    dq.EmplaceBack(1);
+  }
+  EXPECT_THROW(dq.EmplaceBack(-1), std::invalid_argument);
+  EXPECT_THROW(dq.EmplaceFront(-1), std::invalid_argument);
+  EXPECT_EQ(dq.Size(), BlockDeque<Picky>::kBlockSize);
+}
+
+TEST(BlockDeque, MovesStrings) {
+  BlockDeque<std::string> dq;
+  std::string text(100, 'x');
+  const char *data = text.data();
+  dq.PushBack(std::move(text));
+  dq.PushFront(dq.Back());
+  EXPECT_EQ(dq.Back().data(), data);
+  EXPECT_EQ(dq.TakeFront(), std::string(100, 'x'));
+  EXPECT_EQ(dq.TakeBack().data(), data);
+}
+
+int main(int argc, char *argv[]) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -1,5 +1,12 @@
 #include "deque.h"
 #include <gtest/gtest.h> // NOLINT (build/c++11)
+#include <algorithm>
+#include <deque>
+#include <memory_resource>
+#include <numeric>
+#include <random>
+#include <string>
+#include <vector>
 
 TEST(Deque, Empty) {
   Deque<int> dq;
@@ -464,7 +471,717 @@ TEST(Deque, Random4_2) {
   EXPECT_EQ(dq.Back(), 23);
 }
 
+TEST(Deque, WrapAroundAgainstStdDeque) {
+  // Mixed pushes and pops at both ends through many wraparounds,
+  // grows and shrinks, checked against std::deque
+  Deque<int> dq;
+  std::deque<int> ref;
+  std::mt19937 rng(7);
+  for (int i = 0; i < 20000; i++) {
+    int op = rng() % 5;
+    if (op == 0) {
+      dq.PushFront(i);
+      ref.push_front(i);
+    } else if (op == 1) {
+      dq.PushBack(i);
+      ref.push_back(i);
+    } else if (op == 2 && !ref.empty()) {
+      dq.PopFront();
+      ref.pop_front();
+    } else if (op == 3 && !ref.empty()) {
+      dq.PopBack();
+      ref.pop_back();
+    } else if (i % 97 == 0) {
+      dq.ShrinkToFit();
+    }
+    ASSERT_EQ(dq.Size(), ref.size());
+    if (!ref.empty()) {
+      ASSERT_EQ(dq.Front(), ref.front());
+      ASSERT_EQ(dq.Back(), ref.back());
+      size_t pos = rng() % ref.size();
+      ASSERT_EQ(dq[pos], ref[pos]);
+    }
+  }
+}
+
+TEST(Deque, ClearAndReuse) {
+  Deque<int> dq;
+  for (int i = 0; i < 100; i++) {
+    dq.PushBack(i);
+  }
+  dq.Clear();
+  EXPECT_EQ(dq.Empty(), true);
+  EXPECT_EQ(dq.Size(), 0);
+  EXPECT_THROW(dq.Front(), std::exception);
+  EXPECT_THROW(dq.PopBack(), std::exception);
+  dq.PushFront(5);
+  dq.PushBack(6);
+  EXPECT_EQ(dq.Size(), 2);
+  EXPECT_EQ(dq[0], 5);
+  EXPECT_EQ(dq[1], 6);
+}
+
+// Counts live objects and copies; has no default constructor
+struct Tracked {
+  static int live;
+  static int copies;
+  static int moves;
+  int value;
+  explicit Tracked(int v) : value(v) { live++; }
+  Tracked(const Tracked &other) : value(other.value) { live++; copies++; }
+  Tracked(Tracked &&other) noexcept : value(other.value) {
+    live++;
+    moves++;
+  }
+  Tracked& operator=(const Tracked&) = delete;
+  ~Tracked() { live--; }
+};
+int Tracked::live = 0;
+int Tracked::copies = 0;
+int Tracked::moves = 0;
+
+TEST(Deque, ConstructsAndDestroysItems) {
+  Tracked::live = 0;
+  Tracked::copies = 0;
+  {
+    Deque<Tracked> dq;
+    EXPECT_EQ(Tracked::live, 0);
+    Tracked item(0);
+    for (int i = 0; i < 100; i++) {
+      item.value = i;
+      dq.PushBack(item);
+      dq.PushFront(item);
+    }
+    // Only the pushed items are alive, growth moved them instead of copying
+    EXPECT_EQ(Tracked::live, 201);
+    EXPECT_EQ(Tracked::copies, 200);
+    for (int i = 0; i < 150; i++) {
+      dq.PopFront();
+    }
+    dq.PopBack();
+    EXPECT_EQ(Tracked::live, 50);
+    dq.ShrinkToFit();
+    EXPECT_EQ(Tracked::live, 50);
+    EXPECT_EQ(dq.Front().value, 50);
+    EXPECT_EQ(dq.Back().value, 98);
+    dq.Clear();
+    EXPECT_EQ(Tracked::live, 1);
+    dq.PushBack(item);
+    EXPECT_EQ(Tracked::live, 2);
+  }
+  EXPECT_EQ(Tracked::live, 0);
+}
+
+TEST(Deque, PushOwnItemWhileGrowing) {
+  Deque<std::string> dq;
+  dq.PushBack("first");
+  for (int i = 0; i < 10; i++) {
+    // Every push that grows the array reads its value from the old array
+    dq.PushBack(dq.Front());
+    dq.PushFront(dq.Back());
+  }
+  EXPECT_EQ(dq.Size(), 21);
+  for (size_t i = 0; i < dq.Size(); i++) {
+    EXPECT_EQ(dq[i], "first");
+  }
+}
+
+TEST(Deque, EmplaceAndMoveWithoutCopies) {
+  Tracked::live = 0;
+  Tracked::copies = 0;
+  Tracked::moves = 0;
+  {
+    Deque<Tracked> dq;
+    dq.EmplaceBack(1);
+    dq.EmplaceFront(0);
+    dq.PushBack(Tracked(2));
+    Tracked item(3);
+    dq.PushBack(std::move(item));
+    // Built in place or moved in, never copied; the array is still 4 long
+    EXPECT_EQ(Tracked::copies, 0);
+    EXPECT_EQ(Tracked::moves, 2);
+    for (int i = 4; i < 1000; i++) {
+      dq.EmplaceBack(i);
+    }
+    EXPECT_EQ(Tracked::copies, 0);
+    Tracked front = dq.TakeFront();
+    Tracked back = dq.TakeBack();
+    EXPECT_EQ(front.value, 0);
+    EXPECT_EQ(back.value, 999);
+    EXPECT_EQ(dq.Size(), 998);
+    EXPECT_EQ(Tracked::live, 1001);
+    EXPECT_EQ(Tracked::copies, 0);
+  }
+  EXPECT_EQ(Tracked::live, 0);
+}
+
+TEST(Deque, MoveKeepsStringBuffer) {
+  Deque<std::string> dq;
+  std::string text(100, 'x');
+  const char *data = text.data();
+  dq.PushBack(std::move(text));
+  dq.EmplaceFront(3, 'y');
+  EXPECT_EQ(dq.Back().data(), data);
+  std::string taken = dq.TakeBack();
+  EXPECT_EQ(taken.data(), data);
+  EXPECT_EQ(dq.TakeFront(), "yyy");
+  EXPECT_TRUE(dq.Empty());
+  EXPECT_THROW(dq.TakeFront(), std::out_of_range);
+  EXPECT_THROW(dq.TakeBack(), std::out_of_range);
+}
+
+// Push 0..@n-1 so the items wrap around the end of the array
+static void FillWrapped(Deque<int> &dq, int n) {
+  for (int i = 0; i < n; i++) {
+    dq.PushBack(i);
+  }
+  for (int i = 0; i < n / 2; i++) {
+    dq.PopFront();
+    dq.PushBack(n + i);
+  }
+}
+
+TEST(Deque, IteratorsWalkInOrder) {
+  Deque<int> dq;
+  EXPECT_TRUE(dq.begin() == dq.end());
+  FillWrapped(dq, 16);
+  int expected = 8;
+  for (int value : dq) {
+    EXPECT_EQ(value, expected++);
+  }
+  EXPECT_EQ(expected, 24);
+  EXPECT_EQ(dq.end() - dq.begin(), 16);
+  EXPECT_EQ(*(dq.begin() + 10), 18);
+  EXPECT_EQ(dq.begin()[15], 23);
+  EXPECT_EQ(*(dq.end() - 1), 23);
+  EXPECT_TRUE(dq.begin() < dq.end());
+  EXPECT_TRUE(dq.begin() + 16 == dq.end());
+
+  const Deque<int> &view = dq;
+  Deque<int>::const_iterator it = dq.begin();
+  EXPECT_TRUE(it == view.cbegin());
+  EXPECT_EQ(std::accumulate(view.begin(), view.end(), 0), 8 * 31);
+  std::vector<int> reversed(view.rbegin(), view.rend());
+  ASSERT_EQ(reversed.size(), 16u);
+  EXPECT_EQ(reversed.front(), 23);
+  EXPECT_EQ(reversed.back(), 8);
+}
+
+TEST(Deque, IteratorsWithAlgorithms) {
+  Deque<int> dq;
+  std::mt19937 rng(7);
+  for (int i = 0; i < 1000; i++) {
+    if (rng() % 2) {
+      dq.PushBack(rng() % 500);
+    } else {
+      dq.PushFront(rng() % 500);
+    }
+  }
+  std::sort(dq.begin(), dq.end());
+  EXPECT_TRUE(std::is_sorted(dq.begin(), dq.end()));
+  auto it = std::lower_bound(dq.begin(), dq.end(), 250);
+  EXPECT_TRUE(it == dq.end() || *it >= 250);
+  EXPECT_TRUE(it == dq.begin() || it[-1] < 250);
+  for (int &value : dq) {
+    value = -value;
+  }
+  EXPECT_TRUE(std::is_sorted(dq.rbegin(), dq.rend()));
+}
 
+TEST(Deque, SegmentsCoverItemsInOrder) {
+  Deque<int> dq;
+  auto spans = dq.Segments();
+  EXPECT_EQ(spans.first.size + spans.second.size, 0u);
+
+  for (int i = 0; i < 5; i++) {
+    dq.PushBack(i);
+  }
+  spans = dq.Segments();
+  EXPECT_EQ(spans.first.size, 5u);
+  EXPECT_EQ(spans.second.size, 0u);
+
+  dq.Clear();
+  FillWrapped(dq, 16);
+  spans = dq.Segments();
+  EXPECT_EQ(spans.first.size, 8u);
+  EXPECT_EQ(spans.second.size, 8u);
+  std::vector<int> items(spans.first.begin(), spans.first.end());
+  items.insert(items.end(), spans.second.begin(), spans.second.end());
+  EXPECT_TRUE(std::equal(items.begin(), items.end(), dq.begin()));
+
+  const Deque<int> &view = dq;
+  auto const_spans = view.Segments();
+  EXPECT_EQ(const_spans.first.data, spans.first.data);
+  EXPECT_EQ(const_spans.second.size, 8u);
+}
+
+TEST(Deque, RangesAcrossTheWrap) {
+  Deque<int> dq;
+  FillWrapped(dq, 16);
+  std::vector<int> items(40);
+  std::iota(items.begin(), items.end(), 100);
+  dq.PushBackRange(items.data(), 40);
+  dq.PushFrontRange(items.data(), 3);
+  dq.PushBackRange(nullptr, 0);
+  ASSERT_EQ(dq.Size(), 59);
+  EXPECT_EQ(dq[0], 100);
+  EXPECT_EQ(dq[2], 102);
+  EXPECT_EQ(dq[3], 8);
+  EXPECT_EQ(dq[19], 100);
+  EXPECT_EQ(dq.Back(), 139);
+
+  std::vector<int> out(64, -1);
+  EXPECT_EQ(dq.PopFrontInto(out.data(), 5), 5);
+  EXPECT_EQ(out[0], 100);
+  EXPECT_EQ(out[3], 8);
+  EXPECT_EQ(out[4], 9);
+  EXPECT_EQ(dq.PopBackInto(out.data(), 4), 4);
+  EXPECT_EQ(out[0], 136);
+  EXPECT_EQ(out[3], 139);
+  EXPECT_EQ(dq.Front(), 10);
+  EXPECT_EQ(dq.Back(), 135);
+  EXPECT_EQ(dq.PopFrontInto(out.data(), 64), 50);
+  EXPECT_EQ(out[49], 135);
+  EXPECT_TRUE(dq.Empty());
+  EXPECT_EQ(dq.PopBackInto(out.data(), 1), 0);
+}
+
+TEST(Deque, RangesOfStrings) {
+  Deque<std::string> dq;
+  std::vector<std::string> items = {"a", "b", "c", "d", "e"};
+  for (int i = 0; i < 3; i++) {
+    dq.PushBack("x");
+    dq.PopFront();
+  }
+  dq.PushBackRange(items.data(), 5);
+  dq.PushFrontRange(items.data(), 2);
+  ASSERT_EQ(dq.Size(), 7);
+  EXPECT_EQ(dq[0], "a");
+  EXPECT_EQ(dq[1], "b");
+  EXPECT_EQ(dq[2], "a");
+  EXPECT_EQ(dq[6], "e");
+  EXPECT_EQ(items[4], "e");
+
+  std::vector<std::string> out(7);
+  EXPECT_EQ(dq.PopBackInto(out.data(), 3), 3);
+  EXPECT_EQ(out[0], "c");
+  EXPECT_EQ(out[2], "e");
+  EXPECT_EQ(dq.PopFrontInto(out.data(), 7), 4);
+  EXPECT_EQ(out[0], "a");
+  EXPECT_EQ(out[3], "b");
+  EXPECT_TRUE(dq.Empty());
+}
+
+// Throws when copied for the third time
+struct Fragile {
+  static int copies;
+  int value;
+  explicit Fragile(int v) : value(v) {}
+  Fragile(const Fragile &other) : value(other.value) {
+    if (++copies == 3) {
+      throw std::runtime_error("copy failed");
+    }
+  }
+};
+int Fragile::copies = 0;
+
+TEST(Deque, FailedRangePushLeavesDequeUnchanged) {
+  Deque<Fragile> dq;
+  dq.EmplaceBack(1);
+  std::vector<Fragile> items;
+  items.reserve(4);
+  for (int i = 0; i < 4; i++) {
+    items.emplace_back(i);
+  }
+  Fragile::copies = 0;
+  EXPECT_THROW(dq.PushFrontRange(items.data(), 4), std::runtime_error);
+  EXPECT_EQ(dq.Size(), 1);
+  EXPECT_EQ(dq.Front().value, 1);
+}
+
+// Counts live objects; moving a negative value out throws
+struct FragileMove {
+  static int live;
+  int value;
+  FragileMove(int v = 0) : value(v) { live++; }  // NOLINT
+  FragileMove(const FragileMove &other) : value(other.value) { live++; }
+  ~FragileMove() { live--; }
+  FragileMove& operator=(FragileMove &&other) {
+    if (other.value < 0) {
+      throw std::runtime_error("move failed");
+    }
+    value = other.value;
+    return *this;
+  }
+};
+int FragileMove::live = 0;
+
+TEST(Deque, FailedPopIntoKeepsTheRest) {
+  {
+    Deque<FragileMove> dq;
+    FragileMove out[4];
+    for (int v : {1, 2, -3, 4}) {
+      dq.EmplaceBack(v);
+    }
+    EXPECT_THROW(dq.PopFrontInto(out, 4), std::runtime_error);
+    EXPECT_EQ(out[1].value, 2);
+    EXPECT_EQ(dq.Size(), 2);
+    EXPECT_EQ(dq.Front().value, -3);
+
+    dq.Clear();
+    for (int v : {1, -2, 3, 4}) {
+      dq.EmplaceBack(v);
+    }
+    EXPECT_THROW(dq.PopBackInto(out, 4), std::runtime_error);
+    EXPECT_EQ(out[2].value, 3);
+    EXPECT_EQ(out[3].value, 4);
+    EXPECT_EQ(dq.Size(), 2);
+    EXPECT_EQ(dq.Back().value, -2);
+    EXPECT_EQ(FragileMove::live, 4 + 2);
+  }
+  EXPECT_EQ(FragileMove::live, 0);
+}
+
+// Allocator that records what it hands out in @stats
+struct AllocStats {
+  size_t allocations = 0;
+  size_t deallocations = 0;
+  size_t live_items = 0;
+};
+
+template <typename T>
+struct CountingAllocator {
+  typedef T value_type;
+  AllocStats *stats;
+
+  explicit CountingAllocator(AllocStats *stats) : stats(stats) {}
+  template <typename U>
+  CountingAllocator(const CountingAllocator<U> &other) : stats(other.stats) {}
+
+  T* allocate(size_t n) {
+    stats->allocations++;
+    stats->live_items += n;
+    return std::allocator<T>().allocate(n);
+  }
+  void deallocate(T *p, size_t n) {
+    stats->deallocations++;
+    stats->live_items -= n;
+    std::allocator<T>().deallocate(p, n);
+  }
+};
+
+template <typename T, typename U>
+bool operator==(const CountingAllocator<T> &a, const CountingAllocator<U> &b) {
+  return a.stats == b.stats;
+}
+
+template <typename T, typename U>
+bool operator!=(const CountingAllocator<T> &a, const CountingAllocator<U> &b) {
+  return a.stats != b.stats;
+}
+
+TEST(Deque, CustomAllocatorSeesEveryBuffer) {
+  AllocStats stats;
+  {
+    Deque<std::string, CountingAllocator<std::string>> dq(
+      (CountingAllocator<std::string>(&stats)));
+    EXPECT_EQ(dq.GetAllocator().stats, &stats);
+    EXPECT_EQ(stats.allocations, 0);
+    for (int i = 0; i < 1000; i++) {
+      dq.PushBack(std::to_string(i));
+    }
+    EXPECT_EQ(stats.live_items, 1024);
+    for (int i = 0; i < 990; i++) {
+      dq.PopFront();
+      dq.ShrinkToFit();
+    }
+    EXPECT_EQ(dq.Front(), "990");
+    EXPECT_LT(stats.live_items, 64);
+  }
+  EXPECT_GT(stats.allocations, 10);
+  EXPECT_EQ(stats.allocations, stats.deallocations);
+  EXPECT_EQ(stats.live_items, 0);
+}
+
+TEST(Deque, PmrDequeStaysInItsResource) {
+  char buffer[1 << 16];
+  // Any allocation beyond the buffer would throw
+  std::pmr::monotonic_buffer_resource arena(buffer, sizeof(buffer),
+    std::pmr::null_memory_resource());
+  pmr::Deque<std::pmr::string> dq(&arena);
+  for (int i = 0; i < 100; i++) {
+    dq.PushBack(std::pmr::string(40, 'a' + i % 26));
+    dq.EmplaceFront(40, 'z');
+  }
+  ASSERT_EQ(dq.Size(), 200);
+  EXPECT_EQ(dq[100], std::pmr::string(40, 'a'));
+  EXPECT_EQ(dq.GetAllocator().resource(), &arena);
+  // Items are built through the allocator, so they use the arena too
+  EXPECT_EQ(dq.Front().get_allocator().resource(), &arena);
+  EXPECT_EQ(dq.Back().get_allocator().resource(), &arena);
+}
+
+TEST(Deque, InlineCapacityAvoidsTheHeap) {
+  AllocStats stats;
+  CountingAllocator<int> allocator(&stats);
+  Deque<int, CountingAllocator<int>, 16> dq(allocator);
+  for (int round = 0; round < 3; round++) {
+    for (int i = 0; i < 16; i++) {
+      dq.PushFront(i);
+    }
+    for (int i = 0; i < 16; i++) {
+      EXPECT_EQ(dq.TakeBack(), i);
+    }
+  }
+  EXPECT_EQ(stats.allocations, 0);
+
+  // Spill to the heap, then move back in once the items fit again
+  for (int i = 0; i < 40; i++) {
+    dq.PushBack(i);
+  }
+  EXPECT_EQ(stats.allocations, 2);
+  EXPECT_EQ(stats.live_items, 64);
+  while (dq.Size() > 4) {
+    dq.PopFront();
+    dq.ShrinkToFit();
+  }
+  // 64 -> 32 -> inline
+  EXPECT_EQ(stats.allocations, 3);
+  EXPECT_EQ(stats.deallocations, 3);
+  EXPECT_EQ(stats.live_items, 0);
+  EXPECT_EQ(dq.Front(), 36);
+  EXPECT_EQ(dq.Back(), 39);
+  dq.PopFront();
+  dq.PopFront();
+  dq.ShrinkToFit();
+  EXPECT_EQ(stats.allocations, 3);
+  EXPECT_EQ(dq.Front(), 38);
+}
+
+TEST(Deque, ShrinkToFitMovesBackIntoSmallInlineBuffer) {
+  // Inline capacity below the smallest heap array
+  AllocStats stats;
+  CountingAllocator<int> allocator(&stats);
+  Deque<int, CountingAllocator<int>, 2> dq(allocator);
+  for (int i = 0; i < 6; i++) {
+    dq.PushBack(i);
+  }
+  EXPECT_GT(stats.live_items, 0);
+  dq.PopFront();
+  dq.PopFront();
+  dq.PopFront();
+  dq.PopFront();
+  size_t allocations = stats.allocations;
+  dq.ShrinkToFit();
+  EXPECT_EQ(stats.allocations, allocations);
+  EXPECT_EQ(stats.live_items, 0);
+  EXPECT_EQ(dq.Front(), 4);
+  EXPECT_EQ(dq.Back(), 5);
+  dq.PushFront(3);
+  EXPECT_EQ(dq.TakeFront(), 3);
+}
+
+TEST(Deque, SmallDequeOfStrings) {
+  SmallDeque<std::string, 4> dq;
+  EXPECT_EQ(dq.kInlineCapacity, 4);
+  for (int i = 0; i < 100; i++) {
+    dq.PushBack(std::string(30, 'a' + i % 26));
+    dq.PushFront(std::to_string(i));
+  }
+  while (dq.Size() > 2) {
+    dq.PopBack();
+    dq.ShrinkToFit();
+  }
+  EXPECT_EQ(dq[0], "99");
+  EXPECT_EQ(dq[1], "98");
+  std::vector<std::string> items(dq.begin(), dq.end());
+  EXPECT_EQ(items.size(), 2);
+}
+
+TEST(Deque, ReserveAndShrinkToFit) {
+  AllocStats stats;
+  CountingAllocator<int> allocator(&stats);
+  Deque<int, CountingAllocator<int>> dq(allocator);
+  dq.Reserve(1000);
+  EXPECT_EQ(dq.Capacity(), 1024);
+  for (int i = 0; i < 1000; i++) {
+    dq.PushBack(i);
+  }
+  EXPECT_EQ(stats.allocations, 1);
+  dq.Clear();
+  EXPECT_EQ(dq.Capacity(), 1024);
+  EXPECT_EQ(stats.allocations, 1);
+
+  for (int i = 0; i < 5; i++) {
+    dq.PushFront(i);
+  }
+  dq.ShrinkToFit();
+  EXPECT_EQ(dq.Capacity(), 8);
+  EXPECT_EQ(dq.Front(), 4);
+  EXPECT_EQ(dq.Back(), 0);
+  dq.Clear();
+  dq.ShrinkToFit();
+  EXPECT_EQ(dq.Capacity(), 0);
+  EXPECT_EQ(stats.live_items, 0);
+  dq.PushBack(7);
+  EXPECT_EQ(dq.Front(), 7);
+}
+
+TEST(Deque, AutoShrinkWithHysteresis) {
+  AllocStats stats;
+  CountingAllocator<int> allocator(&stats);
+  Deque<int, CountingAllocator<int>> dq(allocator);
+  dq.SetAutoShrink(true);
+  for (int i = 0; i < 1024; i++) {
+    dq.PushBack(i);
+  }
+  EXPECT_EQ(dq.Capacity(), 1024);
+  while (dq.Size() > 255) {
+    dq.PopFront();
+  }
+  EXPECT_EQ(dq.Capacity(), 512);
+  EXPECT_EQ(dq.Front(), 1024 - 255);
+
+  // Hovering around either boundary does not reallocate
+  size_t allocations = stats.allocations;
+  for (int i = 0; i < 1000; i++) {
+    dq.PushBack(i);
+    dq.PopFront();
+  }
+  while (dq.Size() < 512) {
+    dq.PushBack(0);
+  }
+  for (int i = 0; i < 1000; i++) {
+    dq.PopFront();
+    dq.PushBack(i);
+  }
+  EXPECT_EQ(stats.allocations, allocations);
+
+  // Not below what was reserved
+  dq.Reserve(100);
+  int out[512];
+  EXPECT_EQ(dq.PopBackInto(out, 512), 512);
+  EXPECT_EQ(dq.Capacity(), 128);
+  dq.SetAutoShrink(false);
+  dq.ShrinkToFit();
+  EXPECT_EQ(dq.Capacity(), 0);
+  EXPECT_EQ(stats.live_items, 0);
+}
+
+TEST(Deque, SizesBeyondTheAllocatorThrow) {
+  Deque<int> dq;
+  dq.PushBack(1);
+  EXPECT_THROW(dq.Reserve(static_cast<size_t>(-1)), std::length_error);
+  EXPECT_THROW(dq.PushBackRange(nullptr, static_cast<size_t>(-2)),
+    std::length_error);
+  EXPECT_EQ(dq.Size(), 1);
+  EXPECT_EQ(dq.Front(), 1);
+  static_assert(sizeof(Deque<int>::iterator::difference_type) ==
+    sizeof(size_t), "iterator distances span the whole size_t range");
+}
+
+TEST(Deque, RingKeepsTheLastItems) {
+  AllocStats stats;
+  CountingAllocator<int> allocator(&stats);
+  Deque<int, CountingAllocator<int>> dq(allocator);
+  EXPECT_EQ(dq.RingSize(), 0);
+  dq.SetRing(5);
+  EXPECT_EQ(dq.RingSize(), 5);
+  EXPECT_EQ(stats.allocations, 1);
+  for (int i = 0; i < 1000; i++) {
+    dq.PushBack(i);
+    ASSERT_EQ(dq.Size(), std::min(i + 1, 5));
+    ASSERT_EQ(dq.Front(), std::max(0, i - 4));
+    ASSERT_EQ(dq.Back(), i);
+  }
+  // PushFront drops the back item instead
+  dq.PushFront(-1);
+  EXPECT_EQ(dq.Front(), -1);
+  EXPECT_EQ(dq.Back(), 998);
+  EXPECT_EQ(stats.allocations, 1);
+
+  int out[5] = {0};
+  EXPECT_EQ(dq.Snapshot(out), 5);
+  int expected[] = {-1, 995, 996, 997, 998};
+  EXPECT_TRUE(std::equal(out, out + 5, expected));
+
+  // Neither shrinking goes below the ring
+  dq.SetAutoShrink(true);
+  dq.PopBack();
+  dq.PopBack();
+  dq.PopBack();
+  dq.PopBack();
+  dq.ShrinkToFit();
+  EXPECT_GE(dq.Capacity(), 5);
+  for (int i = 0; i < 10; i++) {
+    dq.PushBack(i);
+  }
+  EXPECT_EQ(dq.Size(), 5);
+  EXPECT_EQ(dq.Front(), 5);
+
+  // Back to growing
+  dq.SetRing(0);
+  dq.PushBack(10);
+  EXPECT_EQ(dq.Size(), 6);
+  EXPECT_EQ(dq.Front(), 5);
+}
+
+TEST(Deque, RingOfAPowerOfTwoOverwritesInPlace) {
+  // The array is exactly full, so the new item is moved over the old one
+  SmallDeque<std::string, 4> dq;
+  dq.SetRing(4);
+  for (int i = 0; i < 10; i++) {
+    dq.PushBack(std::to_string(i));
+  }
+  EXPECT_EQ(dq.Capacity(), 4);
+  EXPECT_EQ(dq.Size(), 4);
+  EXPECT_EQ(dq.Front(), "6");
+  // Pushing a copy of the item being overwritten
+  dq.PushBack(dq.Front());
+  EXPECT_EQ(dq.Front(), "7");
+  EXPECT_EQ(dq.Back(), "6");
+  dq.PushFront(dq.Back());
+  EXPECT_EQ(dq.Front(), "6");
+  EXPECT_EQ(dq.Back(), "9");
+
+  std::string out[4];
+  EXPECT_EQ(dq.Snapshot(out), 4);
+  EXPECT_EQ(out[0], "6");
+  EXPECT_EQ(out[1], "7");
+  EXPECT_EQ(out[3], "9");
+}
+
+TEST(Deque, RingWithRangesAndAShrinkingSetRing) {
+  Deque<int> dq;
+  for (int i = 0; i < 10; i++) {
+    dq.PushBack(i);
+  }
+  // The front items go
+  dq.SetRing(3);
+  EXPECT_EQ(dq.Size(), 3);
+  EXPECT_EQ(dq.Front(), 7);
+
+  int items[] = {10, 11, 12, 13, 14};
+  dq.PushBackRange(items, 2);
+  EXPECT_EQ(dq.Size(), 3);
+  EXPECT_EQ(dq.Front(), 9);
+  EXPECT_EQ(dq.Back(), 11);
+  dq.PushBackRange(items, 5);
+  EXPECT_EQ(dq.Front(), 12);
+  EXPECT_EQ(dq.Back(), 14);
+  dq.PushFrontRange(items, 2);
+  EXPECT_EQ(dq.Front(), 10);
+  EXPECT_EQ(dq.Back(), 12);
+  dq.PushFrontRange(items + 1, 4);
+  int out[3];
+  EXPECT_EQ(dq.Snapshot(out), 3);
+  EXPECT_EQ(out[0], 11);
+  EXPECT_EQ(out[1], 12);
+  EXPECT_EQ(out[2], 13);
+
+  Deque<int> empty;
+  EXPECT_EQ(empty.Snapshot(out), 0);
+}
 
 int main(int argc, char *argv[]) {
   ::testing::InitGoogleTest(&argc, argv);
@@ -0,0 +1,118 @@
+#include "mpmc_queue.h"
+#include <gtest/gtest.h> // NOLINT (build/c++11)
+#include <atomic>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+TEST(MpmcQueue, Empty) {
+  MpmcQueue<int> q(3);
+
+  /* Capacity rounds up to a power of two */
+  EXPECT_EQ(q.Capacity(), 4);
+  EXPECT_EQ(q.Empty(), true);
+  EXPECT_EQ(q.Size(), 0);
+  int out;
+  EXPECT_FALSE(q.TryPop(out));
+  EXPECT_EQ(MpmcQueue<int>(1).Capacity(), 2);
+  EXPECT_THROW(MpmcQueue<int>(0), std::invalid_argument);
+}
+
+TEST(MpmcQueue, FillAndDrainAcrossTheWrap) {
+  MpmcQueue<std::string> q(4);
+  std::string out;
+  for (int round = 0; round < 10; round++) {
+    for (int i = 0; i < 4; i++) {
+      EXPECT_TRUE(q.TryPush(std::to_string(round * 4 + i)));
+    }
+    EXPECT_FALSE(q.TryPush("full"));
+    EXPECT_EQ(q.Size(), 4);
+    for (int i = 0; i < 3; i++) {
+      EXPECT_TRUE(q.TryPop(out));
+      EXPECT_EQ(out, std::to_string(round * 4 + i));
+    }
+    EXPECT_EQ(q.Pop(), std::to_string(round * 4 + 3));
+    EXPECT_FALSE(q.TryPop(out));
+    q.Push("x");
+    q.TryPop(out);
+  }
+}
+
+TEST(MpmcQueue, DestroysItemsLeft) {
+  std::shared_ptr<int> item = std::make_shared<int>(7);
+  {
+    MpmcQueue<std::shared_ptr<int>> q(8);
+    q.TryPush(item);
+    q.TryEmplace(item);
+    q.Pop();
+    EXPECT_EQ(item.use_count(), 2);
+  }
+  EXPECT_EQ(item.use_count(), 1);
+}
+
+TEST(MpmcQueue, ManyProducersAndConsumers) {
+  MpmcQueue<long> q(16);
+  const int producers = 4;
+  const int consumers = 4;
+  const long per_producer = 50000;
+  std::atomic<long> sum(0);
+  std::atomic<long> count(0);
+  std::atomic<bool> ordered(true);
+  std::vector<std::thread> threads;
+  for (int p = 0; p < producers; p++) {
+    threads.emplace_back([&q, p]() {
+      for (long i = 0; i < per_producer; i++) {
+        // Producer in the high bits, sequence in the low ones
+        q.Push((static_cast<long>(p) << 32) | i);
+      }
+    });
+  }
+  for (int c = 0; c < consumers; c++) {
+    threads.emplace_back([&]() {
+      // Each producer's items must come out in the order they went in
+      std::vector<long> last(producers, -1);
+      long value;
+      while (count.load() < producers * per_producer) {
+        if (q.TryPop(value)) {
+          long p = value >> 32;
+          long i = value & 0xffffffffL;
+          if (i <= last[p]) {
+            ordered = false;
+          }
+          last[p] = i;
+          sum += i;
+          count++;
+        } else {
+          std::this_thread::yield();
+        }
+      }
+    });
+  }
+  for (auto &t : threads) {
+    t.join();
+  }
+  EXPECT_EQ(count.load(), producers * per_producer);
+  EXPECT_EQ(sum.load(), producers * (per_producer * (per_producer - 1) / 2));
+  EXPECT_TRUE(ordered.load());
+  EXPECT_TRUE(q.Empty());
+}
+
+TEST(MpmcQueue, BlockingPopWaitsForPush) {
+  MpmcQueue<int> q(2);
+  std::thread consumer([&q]() {
+    for (int i = 0; i < 1000; i++) {
+      EXPECT_EQ(q.Pop(), i);
+    }
+  });
+  for (int i = 0; i < 1000; i++) {
+    q.Push(i);
+  }
+  consumer.join();
+  EXPECT_TRUE(q.Empty());
+}
+
+int main(int argc, char *argv[]) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
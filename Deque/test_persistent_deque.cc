@@ -0,0 +1,108 @@
+#include "persistent_deque.h"
+#include <gtest/gtest.h> // NOLINT (build/c++11)
+#include <unistd.h>
+#include <cstdio>
+#include <deque>
+#include <random>
+#include <string>
+
+// A file name of its own for each test, removed before and after
+class PersistentDequeTest : public ::testing::Test {
+ protected:
+  std::string path;
+
+  void SetUp() override {
+    path = "/tmp/test_persistent_deque_" + std::to_string(getpid()) + "_" +
+      ::testing::UnitTest::GetInstance()->current_test_info()->name();
+    std::remove(path.c_str());
+  }
+  void TearDown() override {
+    std::remove(path.c_str());
+  }
+};
+
+TEST_F(PersistentDequeTest, Empty) {
+  PersistentDeque<int> dq(path, 5);
+
+  EXPECT_EQ(dq.Empty(), true);
+  EXPECT_EQ(dq.Size(), 0);
+  EXPECT_EQ(dq.Capacity(), 8);
+  EXPECT_THROW(dq.PopFront(), std::out_of_range);
+  EXPECT_THROW(dq.Front(), std::out_of_range);
+}
+
+TEST_F(PersistentDequeTest, ContentsSurviveReopening) {
+  {
+    PersistentDeque<int> dq(path, 4);
+    for (int i = 0; i < 3; i++) {
+      dq.PushBack(i);
+      dq.PushFront(-i - 1);
+    }
+    dq.PopBack();
+    dq.Sync();
+  }
+  PersistentDeque<int> dq(path);
+  ASSERT_EQ(dq.Size(), 5);
+  EXPECT_EQ(dq.Capacity(), 8);
+  EXPECT_EQ(dq.Front(), -3);
+  EXPECT_EQ(dq.Back(), 1);
+  EXPECT_EQ(dq[2], -1);
+  EXPECT_EQ(dq[3], 0);
+  EXPECT_THROW(dq[5], std::out_of_range);
+}
+
+TEST_F(PersistentDequeTest, GrowsAcrossTheWrapAndReopens) {
+  std::deque<long long> ref;
+  {
+    PersistentDeque<long long> dq(path, 2);
+    std::mt19937 rng(3);
+    for (int i = 0; i < 20000; i++) {
+      unsigned int op = rng() % 6;
+      if (op < 2) {
+        dq.PushBack(i);
+        ref.push_back(i);
+      } else if (op < 4) {
+        dq.PushFront(-i);
+        ref.push_front(-i);
+      } else if (op == 4 && !ref.empty()) {
+        dq.PopFront();
+        ref.pop_front();
+      } else if (!ref.empty()) {
+        dq.PopBack();
+        ref.pop_back();
+      }
+      ASSERT_EQ(dq.Size(), ref.size());
+    }
+  }
+  PersistentDeque<long long> dq(path);
+  ASSERT_EQ(dq.Size(), ref.size());
+  for (size_t i = 0; i < ref.size(); i++) {
+    ASSERT_EQ(dq[i], ref[i]);
+  }
+  dq.Clear();
+  EXPECT_TRUE(dq.Empty());
+}
+
+TEST_F(PersistentDequeTest, RejectsOtherFiles) {
+  {
+    PersistentDeque<int> dq(path);
+    dq.PushBack(1);
+  }
+  EXPECT_THROW(PersistentDeque<long long> dq(path), std::runtime_error);
+
+  FILE *f = std::fopen(path.c_str(), "w");
+  std::fputs("not a deque", f);
+  std::fclose(f);
+  EXPECT_THROW(PersistentDeque<int> dq(path), std::runtime_error);
+}
+
+TEST_F(PersistentDequeTest, RejectsHugeCapacity) {
+  EXPECT_THROW(PersistentDeque<int> dq(path, static_cast<size_t>(-1)),
+    std::invalid_argument);
+  EXPECT_NE(access(path.c_str(), F_OK), 0);
+}
+
+int main(int argc, char *argv[]) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,118 @@
+#include "sliding_window.h"
+#include <gtest/gtest.h> // NOLINT (build/c++11)
+#include <algorithm>
+#include <deque>
+#include <random>
+#include <string>
+
+TEST(SlidingWindow, Empty) {
+  SlidingMin<int> lo(3);
+  SlidingAggregate<int, std::plus<int>> sum(3);
+
+  EXPECT_EQ(lo.Empty(), true);
+  EXPECT_EQ(lo.Size(), 0);
+  EXPECT_THROW(lo.Best(), std::out_of_range);
+  EXPECT_EQ(sum.Empty(), true);
+  EXPECT_THROW(sum.Query(), std::out_of_range);
+  EXPECT_THROW(sum.Pop(), std::out_of_range);
+  EXPECT_THROW(SlidingMax<int>(0), std::invalid_argument);
+}
+
+TEST(SlidingWindow, MinAndMax) {
+  SlidingMin<int> lo(3);
+  SlidingMax<int> hi(3);
+  int samples[] = {5, 3, 4, 4, 8, 1, 7, 7, 9};
+  int lows[] = {5, 3, 3, 3, 4, 1, 1, 1, 7};
+  int highs[] = {5, 5, 5, 4, 8, 8, 8, 7, 9};
+  for (int i = 0; i < 9; i++) {
+    lo.Push(samples[i]);
+    hi.Push(samples[i]);
+    EXPECT_EQ(lo.Best(), lows[i]);
+    EXPECT_EQ(hi.Best(), highs[i]);
+  }
+  EXPECT_EQ(lo.Size(), 3);
+  lo.Clear();
+  EXPECT_TRUE(lo.Empty());
+  lo.Push(42);
+  EXPECT_EQ(lo.Best(), 42);
+}
+
+struct Gcd {
+  long long operator()(long long a, long long b) const {
+    while (b) {
+      long long t = a % b;
+      a = b;
+      b = t;
+    }
+    return a;
+  }
+};
+
+struct Min {
+  int operator()(int a, int b) const { return std::min(a, b); }
+};
+
+TEST(SlidingWindow, RandomAgainstBruteForce) {
+  std::mt19937 rng(11);
+  for (size_t window : {1, 2, 5, 64}) {
+    SlidingMin<int> lo(window);
+    SlidingMax<int> hi(window);
+    SlidingAggregate<int, Min> folded_min(window);
+    SlidingAggregate<long long, std::plus<long long>> sum(window);
+    SlidingAggregate<long long, Gcd> gcd(window);
+    std::deque<int> ref;
+    for (int i = 0; i < 5000; i++) {
+      int value = rng() % 1000;
+      // Multiples of 6 most of the time, so the gcd is not always 1
+      int multiple = 6 * (1 + rng() % 50);
+      int sample = i % 7 ? multiple : value;
+      lo.Push(sample);
+      hi.Push(sample);
+      folded_min.Push(sample);
+      sum.Push(sample);
+      gcd.Push(sample);
+      ref.push_back(sample);
+      if (ref.size() > window) {
+        ref.pop_front();
+      }
+      ASSERT_EQ(lo.Size(), ref.size());
+      ASSERT_EQ(sum.Size(), ref.size());
+      ASSERT_EQ(lo.Best(), *std::min_element(ref.begin(), ref.end()));
+      ASSERT_EQ(hi.Best(), *std::max_element(ref.begin(), ref.end()));
+      ASSERT_EQ(folded_min.Query(), lo.Best());
+      long long total = 0;
+      long long divisor = 0;
+      for (int x : ref) {
+        total += x;
+        divisor = Gcd()(divisor, x);
+      }
+      ASSERT_EQ(sum.Query(), total);
+      ASSERT_EQ(gcd.Query(), divisor);
+    }
+  }
+}
+
+TEST(SlidingWindow, AggregateKeepsTheOrder) {
+  // Concatenation is associative but not commutative
+  SlidingAggregate<std::string, std::plus<std::string>> text(4);
+  std::string expected;
+  for (char c = 'a'; c <= 'z'; c++) {
+    text.Push(std::string(1, c));
+    expected += c;
+    if (expected.size() > 4) {
+      expected.erase(0, 1);
+    }
+    ASSERT_EQ(text.Query(), expected);
+  }
+  text.Pop();
+  text.Pop();
+  EXPECT_EQ(text.Query(), "yz");
+  text.Clear();
+  text.Push("q");
+  EXPECT_EQ(text.Query(), "q");
+}
+
+int main(int argc, char *argv[]) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
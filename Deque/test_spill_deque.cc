@@ -0,0 +1,106 @@
+#include "spill_deque.h"
+#include <gtest/gtest.h> // NOLINT (build/c++11)
+#include <algorithm>
+#include <deque>
+#include <random>
+
+TEST(SpillDeque, Empty) {
+  SpillDeque<int> dq;
+
+  EXPECT_EQ(dq.Empty(), true);
+  EXPECT_EQ(dq.Size(), 0);
+  EXPECT_THROW(dq.PopFront(), std::out_of_range);
+  EXPECT_THROW(dq.Back(), std::out_of_range);
+  EXPECT_THROW(SpillDeque<int>(1), std::invalid_argument);
+}
+
+TEST(SpillDeque, QueueSpillsTheMiddle) {
+  SpillDeque<int> dq(3, 16);
+  for (int i = 0; i < 1000; i++) {
+    dq.PushBack(i);
+    EXPECT_LE(dq.MemorySegments(), 3);
+  }
+  EXPECT_EQ(dq.Size(), 1000);
+  EXPECT_EQ(dq.MemorySegments() + dq.SpilledSegments(), 63);
+  EXPECT_EQ(dq.Front(), 0);
+  EXPECT_EQ(dq.Back(), 999);
+  for (int i = 0; i < 1000; i++) {
+    ASSERT_EQ(dq.Front(), i);
+    dq.PopFront();
+    EXPECT_LE(dq.MemorySegments(), 3);
+  }
+  EXPECT_TRUE(dq.Empty());
+  EXPECT_EQ(dq.SpilledSegments(), 0);
+}
+
+TEST(SpillDeque, StackAtTheFront) {
+  SpillDeque<long long> dq(2, 8);
+  for (int i = 0; i < 500; i++) {
+    dq.PushFront(i);
+  }
+  EXPECT_GT(dq.SpilledSegments(), 0);
+  for (int i = 499; i >= 0; i--) {
+    ASSERT_EQ(dq.Front(), i);
+    dq.PopFront();
+  }
+  EXPECT_TRUE(dq.Empty());
+}
+
+TEST(SpillDeque, ClearAndReuse) {
+  SpillDeque<int> dq(2, 4);
+  for (int i = 0; i < 100; i++) {
+    dq.PushBack(i);
+  }
+  dq.Clear();
+  EXPECT_TRUE(dq.Empty());
+  EXPECT_EQ(dq.MemorySegments(), 0);
+  EXPECT_EQ(dq.SpilledSegments(), 0);
+  for (int i = 0; i < 100; i++) {
+    dq.PushFront(i);
+  }
+  EXPECT_EQ(dq.Back(), 0);
+  EXPECT_EQ(dq.Front(), 99);
+}
+
+struct Sample {
+  int id;
+  double value;
+};
+
+TEST(SpillDeque, RandomAgainstStdDeque) {
+  SpillDeque<Sample> dq(3, 8);
+  std::deque<Sample> ref;
+  std::mt19937 rng(7);
+  size_t most_spilled = 0;
+  for (int i = 0; i < 50000; i++) {
+    unsigned int op = rng() % 10;
+    // Grow in bursts so segments get spilled and read back
+    if (op < 3 || (op < 6 && i % 2000 < 1000)) {
+      dq.PushBack({i, i * 0.5});
+      ref.push_back({i, i * 0.5});
+    } else if (op < 6) {
+      dq.PushFront({-i, i * 0.25});
+      ref.push_front({-i, i * 0.25});
+    } else if (op < 8 && !ref.empty()) {
+      dq.PopFront();
+      ref.pop_front();
+    } else if (!ref.empty()) {
+      dq.PopBack();
+      ref.pop_back();
+    }
+    ASSERT_EQ(dq.Size(), ref.size());
+    if (!ref.empty()) {
+      ASSERT_EQ(dq.Front().id, ref.front().id);
+      ASSERT_EQ(dq.Back().id, ref.back().id);
+      ASSERT_EQ(dq.Back().value, ref.back().value);
+    }
+    ASSERT_LE(dq.MemorySegments(), 3);
+    most_spilled = std::max(most_spilled, dq.SpilledSegments());
+  }
+  EXPECT_GT(most_spilled, 10);
+}
+
+int main(int argc, char *argv[]) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,155 @@
+#include "spsc_queue.h"
+#include <gtest/gtest.h> // NOLINT (build/c++11)
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+TEST(SpscQueue, Empty) {
+  SpscQueue<int> q(5);
+
+  /* Capacity rounds up to a power of two */
+  EXPECT_EQ(q.Capacity(), 8);
+  EXPECT_EQ(q.Empty(), true);
+  EXPECT_EQ(q.Size(), 0);
+  int out;
+  EXPECT_FALSE(q.TryPop(out));
+  EXPECT_THROW(SpscQueue<int>(0), std::invalid_argument);
+}
+
+TEST(SpscQueue, FillAndDrainAcrossTheWrap) {
+  SpscQueue<int> q(4);
+  int out;
+  for (int round = 0; round < 10; round++) {
+    for (int i = 0; i < 4; i++) {
+      EXPECT_TRUE(q.TryPush(round * 4 + i));
+    }
+    EXPECT_FALSE(q.TryPush(-1));
+    EXPECT_EQ(q.Size(), 4);
+    for (int i = 0; i < 4; i++) {
+      EXPECT_TRUE(q.TryPop(out));
+      EXPECT_EQ(out, round * 4 + i);
+    }
+    EXPECT_FALSE(q.TryPop(out));
+    // Leave one item so the next round wraps
+    q.TryPush(0);
+    q.TryPop(out);
+  }
+}
+
+TEST(SpscQueue, Batches) {
+  SpscQueue<int> q(8);
+  std::vector<int> items = {1, 2, 3, 4, 5, 6};
+  EXPECT_EQ(q.PushBatch(items.data(), 6), 6);
+  EXPECT_EQ(q.PushBatch(items.data(), 6), 2);
+  EXPECT_EQ(q.Size(), 8);
+  std::vector<int> out(10);
+  EXPECT_EQ(q.PopBatch(out.data(), 3), 3);
+  EXPECT_EQ(out[2], 3);
+  EXPECT_EQ(q.PopBatch(out.data(), 10), 5);
+  EXPECT_EQ(out[3], 1);
+  EXPECT_EQ(out[4], 2);
+  EXPECT_EQ(q.PopBatch(out.data(), 10), 0);
+}
+
+TEST(SpscQueue, MovesAndDestroysItems) {
+  std::shared_ptr<int> item = std::make_shared<int>(7);
+  {
+    SpscQueue<std::shared_ptr<int>> q(4);
+    q.TryPush(item);
+    q.TryEmplace(item);
+    q.TryPush(std::make_shared<int>(8));
+    EXPECT_EQ(item.use_count(), 3);
+    std::shared_ptr<int> out;
+    EXPECT_TRUE(q.TryPop(out));
+    EXPECT_EQ(out, item);
+    out.reset();
+    EXPECT_EQ(item.use_count(), 2);
+  }
+  // The destructor released what was left
+  EXPECT_EQ(item.use_count(), 1);
+}
+
+// Counts live objects; moving a negative value out throws
+struct Fragile {
+  static int live;
+  int value;
+  Fragile(int v = 0) : value(v) { live++; }  // NOLINT (runtime/explicit)
+  Fragile(const Fragile &other) : value(other.value) { live++; }
+  ~Fragile() { live--; }
+  Fragile& operator=(Fragile &&other) {
+    if (other.value < 0) {
+      throw std::runtime_error("fragile");
+    }
+    value = other.value;
+    return *this;
+  }
+};
+
+int Fragile::live = 0;
+
+TEST(SpscQueue, ThrowingMoveInPopBatch) {
+  {
+    SpscQueue<Fragile> q(8);
+    Fragile items[] = {1, 2, -3, 4};
+    EXPECT_EQ(q.PushBatch(items, 4), 4);
+    Fragile out[4];
+    EXPECT_THROW(q.PopBatch(out, 4), std::runtime_error);
+    EXPECT_EQ(out[1].value, 2);
+    // The items before the throw are gone, the one that threw is next
+    EXPECT_EQ(q.Size(), 2);
+    EXPECT_EQ(Fragile::live, 4 + 4 + 2);
+  }
+  EXPECT_EQ(Fragile::live, 0);
+}
+
+// The threads yield whenever the queue is full or empty, so the test stays
+// quick when they share one core
+TEST(SpscQueue, TwoThreadsKeepOrder) {
+  SpscQueue<long> q(64);
+  const long n = 200000;
+  std::thread producer([&q]() {
+    long batch[7];
+    long next = 0;
+    while (next < n) {
+      if (next % 3 == 0) {
+        // Mix single pushes with batches
+        size_t count = 0;
+        for (; count < 7 && next + static_cast<long>(count) < n; count++) {
+          batch[count] = next + count;
+        }
+        size_t pushed = q.PushBatch(batch, count);
+        next += pushed;
+        if (pushed == 0) {
+          std::this_thread::yield();
+        }
+      } else if (q.TryPush(next)) {
+        next++;
+      } else {
+        std::this_thread::yield();
+      }
+    }
+  });
+  long expected = 0;
+  long out[5];
+  bool ordered = true;
+  while (expected < n) {
+    size_t got = q.PopBatch(out, 5);
+    if (got == 0) {
+      std::this_thread::yield();
+    }
+    for (size_t i = 0; i < got; i++) {
+      ordered = ordered && out[i] == expected;
+      expected++;
+    }
+  }
+  producer.join();
+  EXPECT_TRUE(ordered);
+  EXPECT_TRUE(q.Empty());
+}
+
+int main(int argc, char *argv[]) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
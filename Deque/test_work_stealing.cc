@@ -0,0 +1,147 @@
+#include "work_stealing_deque.h"
+#include "work_stealing_pool.h"
+#include <gtest/gtest.h> // NOLINT (build/c++11)
+#include <atomic>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+TEST(WorkStealingDeque, OwnerPopsBackThiefStealsFront) {
+  WorkStealingDeque<int> dq(2);
+  int out;
+  EXPECT_TRUE(dq.Empty());
+  EXPECT_FALSE(dq.Pop(out));
+  EXPECT_FALSE(dq.Steal(out));
+  // Grows from 2 slots while keeping the order
+  for (int i = 0; i < 100; i++) {
+    dq.Push(i);
+  }
+  EXPECT_EQ(dq.Size(), 100);
+  EXPECT_TRUE(dq.Steal(out));
+  EXPECT_EQ(out, 0);
+  EXPECT_TRUE(dq.Pop(out));
+  EXPECT_EQ(out, 99);
+  EXPECT_TRUE(dq.Steal(out));
+  EXPECT_EQ(out, 1);
+  for (int i = 98; i >= 2; i--) {
+    EXPECT_TRUE(dq.Pop(out));
+    EXPECT_EQ(out, i);
+  }
+  EXPECT_FALSE(dq.Pop(out));
+  EXPECT_FALSE(dq.Steal(out));
+  EXPECT_TRUE(dq.Empty());
+}
+
+TEST(WorkStealingDeque, EveryItemTakenOnce) {
+  WorkStealingDeque<int> dq(4);
+  const int n = 200000;
+  const int thieves = 3;
+  std::vector<std::atomic<int>> taken(n);
+  for (auto &t : taken) {
+    t = 0;
+  }
+  std::atomic<bool> done(false);
+  std::vector<std::thread> threads;
+  for (int i = 0; i < thieves; i++) {
+    threads.emplace_back([&]() {
+      int out;
+      while (!done || !dq.Empty()) {
+        if (dq.Steal(out)) {
+          taken[out]++;
+        } else {
+          std::this_thread::yield();
+        }
+      }
+    });
+  }
+  // The owner mixes pushes and pops so the last item is often contested
+  int out;
+  for (int i = 0; i < n; i++) {
+    dq.Push(i);
+    if (i % 3 == 0 && dq.Pop(out)) {
+      taken[out]++;
+    }
+  }
+  while (dq.Pop(out)) {
+    taken[out]++;
+  }
+  done = true;
+  for (auto &t : threads) {
+    t.join();
+  }
+  int wrong = 0;
+  for (auto &t : taken) {
+    wrong += t != 1;
+  }
+  EXPECT_EQ(wrong, 0);
+}
+
+TEST(WorkStealingPool, RunsEveryTask) {
+  WorkStealingPool pool(4);
+  EXPECT_EQ(pool.Threads(), 4);
+  std::atomic<long> sum(0);
+  for (int i = 1; i <= 10000; i++) {
+    pool.Submit([&sum, i]() { sum += i; });
+  }
+  pool.Wait();
+  EXPECT_EQ(sum.load(), 10000L * 10001 / 2);
+  // The pool can be reused after Wait()
+  pool.Submit([&sum]() { sum = 0; });
+  pool.Wait();
+  EXPECT_EQ(sum.load(), 0);
+}
+
+// Count the leaves of a binary tree of @depth, one task per node
+static void Leaves(WorkStealingPool &pool, int depth, std::atomic<long> &n) {
+  if (depth == 0) {
+    n++;
+    return;
+  }
+  pool.Submit([&pool, depth, &n]() { Leaves(pool, depth - 1, n); });
+  Leaves(pool, depth - 1, n);
+}
+
+TEST(WorkStealingPool, NestedSubmits) {
+  WorkStealingPool pool(3);
+  std::atomic<long> leaves(0);
+  pool.Submit([&pool, &leaves]() { Leaves(pool, 16, leaves); });
+  pool.Wait();
+  EXPECT_EQ(leaves.load(), 1L << 16);
+}
+
+TEST(WorkStealingPool, SubmitToAnotherPoolKeepsOwnDeque) {
+  // A lone worker runs tasks from its own deque newest first, and shared
+  // queue tasks oldest first
+  WorkStealingPool pool(1);
+  WorkStealingPool other(1);
+  std::vector<int> order;
+  pool.Submit([&]() {
+    other.Submit([]() {});
+    pool.Submit([&order]() { order.push_back(1); });
+    pool.Submit([&order]() { order.push_back(2); });
+  });
+  pool.Wait();
+  other.Wait();
+  EXPECT_EQ(order, std::vector<int>({2, 1}));
+}
+
+TEST(WorkStealingPool, WaitRethrowsTaskException) {
+  WorkStealingPool pool(2);
+  std::atomic<int> ran(0);
+  for (int i = 0; i < 10; i++) {
+    pool.Submit([&ran, i]() {
+      ran++;
+      if (i == 5) {
+        throw std::runtime_error("task failed");
+      }
+    });
+  }
+  EXPECT_THROW(pool.Wait(), std::runtime_error);
+  EXPECT_EQ(ran.load(), 10);
+  pool.Wait();
+}
+
+int main(int argc, char *argv[]) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
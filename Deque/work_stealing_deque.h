@@ -0,0 +1,204 @@
+#ifndef WORK_STEALING_DEQUE_H_
+#define WORK_STEALING_DEQUE_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <vector>
+
+// Chase-Lev work-stealing deque, with the memory orderings of Le, Pop,
+// Cohen and Zappa Nardelli (PPoPP 2013). One owner thread pushes and pops
+// at the back like a stack; any number of thieves steal from the front.
+// Like Deque it is a power-of-two ring reached through logical positions
+// (top is the front, bottom one past the back) masked by capacity - 1;
+// the owner doubles the ring when it fills. Thieves may still be reading
+// an old ring, so replaced rings are freed only with the deque.
+//
+// Items are read and written as atomics while a thief races the owner for
+// them, so T must be trivially copyable (typically a pointer to a task).
+template<typename T>
+class WorkStealingDeque {
+ public:
+  // Assumed cache line size; top and bottom live this far apart
+  static const size_t kCacheLine = 64;
+
+  // Constructor, with room for @capacity items before the first growth
+  // (rounded up to a power of two)
+  explicit WorkStealingDeque(size_t capacity = 64);
+  // Destructor; no thread may be using the deque
+  ~WorkStealingDeque();
+
+
+  //
+  // Capacity
+  //
+
+  // Return number of items, a snapshot while thieves are running
+  // Complexity: O(1)
+  size_t Size() const noexcept;
+  // Return true if Size() is 0
+  // Complexity: O(1)
+  bool Empty() const noexcept;
+
+
+  //
+  // Owner thread only
+  //
+
+  // Push item @value at back of deque
+  // Complexity: O(1) amortized
+  void Push(T value);
+  // Take the item at back of deque into @out, return false if there is
+  // none (or a thief took the last one first)
+  // Complexity: O(1)
+  bool Pop(T &out);
+
+
+  //
+  // Any thread
+  //
+
+  // Take the item at front of deque into @out, return false if there is
+  // none or another thread won the race for it
+  // Complexity: O(1), lock-free
+  bool Steal(T &out);
+
+ private:
+    struct Ring {
+      std::atomic<T> *slots;
+      int64_t mask;
+
+      explicit Ring(int64_t size) : slots(new std::atomic<T>[size]),
+        mask(size - 1) {}
+      ~Ring() { delete[] slots; }
+      T Get(int64_t i) const noexcept {
+        return slots[i & mask].load(std::memory_order_relaxed);
+      }
+      void Put(int64_t i, T value) noexcept {
+        slots[i & mask].store(value, std::memory_order_relaxed);
+      }
+    };
+    char pad0[kCacheLine];
+    // Front, advanced by thieves and by the owner taking the last item
+    std::atomic<int64_t> top;
+    char pad1[kCacheLine];
+    // One past the back, written by the owner only
+    std::atomic<int64_t> bottom;
+    std::atomic<Ring*> ring;
+    // Rings replaced by larger ones, owned by the owner thread
+    std::vector<Ring*> retired;
+    char pad2[kCacheLine];
+
+    Ring* grow(Ring *old, int64_t t, int64_t b);
+
+    // Thieves hold the deque by address; it is neither copied nor moved
+    WorkStealingDeque(const WorkStealingDeque&) = delete;
+    WorkStealingDeque& operator=(const WorkStealingDeque&) = delete;
+};
+
+template <typename T>
+const size_t WorkStealingDeque<T>::kCacheLine;
+
+template <typename T>
+WorkStealingDeque<T>::WorkStealingDeque(size_t capacity) {
+  static_assert(std::is_trivially_copyable<T>::value,
+    "WorkStealingDeque items must be trivially copyable");
+  int64_t size = 2;
+  while (size < static_cast<int64_t>(capacity)) {
+    size *= 2;
+  }
+  top.store(0, std::memory_order_relaxed);
+  bottom.store(0, std::memory_order_relaxed);
+  ring.store(new Ring(size), std::memory_order_relaxed);
+}
+
+template <typename T>
+WorkStealingDeque<T>::~WorkStealingDeque() {
+  delete ring.load(std::memory_order_relaxed);
+  for (Ring *r : retired) {
+    delete r;
+  }
+}
+
+template <typename T>
+size_t WorkStealingDeque<T>::Size() const noexcept {
+  int64_t b = bottom.load(std::memory_order_relaxed);
+  int64_t t = top.load(std::memory_order_relaxed);
+  return b > t ? static_cast<size_t>(b - t) : 0;
+}
+
+template <typename T>
+bool WorkStealingDeque<T>::Empty() const noexcept {
+  return Size() == 0;
+}
+
+// Copy the items in [@t, @b) of @old into a ring twice as large
+template <typename T>
+typename WorkStealingDeque<T>::Ring* WorkStealingDeque<T>::grow(Ring *old,
+  int64_t t, int64_t b) {
+  Ring *bigger = new Ring(2 * (old->mask + 1));
+  for (int64_t i = t; i < b; i++) {
+    bigger->Put(i, old->Get(i));
+  }
+  retired.push_back(old);
+  ring.store(bigger, std::memory_order_release);
+  return bigger;
+}
+
+template <typename T>
+void WorkStealingDeque<T>::Push(T value) {
+  int64_t b = bottom.load(std::memory_order_relaxed);
+  int64_t t = top.load(std::memory_order_acquire);
+  Ring *r = ring.load(std::memory_order_relaxed);
+  if (b - t > r->mask) {
+    r = grow(r, t, b);
+  }
+  r->Put(b, value);
+  std::atomic_thread_fence(std::memory_order_release);
+  bottom.store(b + 1, std::memory_order_relaxed);
+}
+
+template <typename T>
+bool WorkStealingDeque<T>::Pop(T &out) {
+  int64_t b = bottom.load(std::memory_order_relaxed) - 1;
+  Ring *r = ring.load(std::memory_order_relaxed);
+  // Claim the back item first, then look at what thieves did
+  bottom.store(b, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  int64_t t = top.load(std::memory_order_relaxed);
+  if (t > b) {
+    // Was empty
+    bottom.store(b + 1, std::memory_order_relaxed);
+    return false;
+  }
+  out = r->Get(b);
+  if (t < b) {
+    return true;
+  }
+  // The last item: race the thieves for it through top
+  bool won = top.compare_exchange_strong(t, t + 1,
+    std::memory_order_seq_cst, std::memory_order_relaxed);
+  bottom.store(b + 1, std::memory_order_relaxed);
+  return won;
+}
+
+template <typename T>
+bool WorkStealingDeque<T>::Steal(T &out) {
+  int64_t t = top.load(std::memory_order_acquire);
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  int64_t b = bottom.load(std::memory_order_acquire);
+  if (t >= b) {
+    return false;
+  }
+  Ring *r = ring.load(std::memory_order_acquire);
+  T value = r->Get(t);
+  if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst,
+    std::memory_order_relaxed)) {
+    return false;
+  }
+  out = value;
+  return true;
+}
+
+#endif  // WORK_STEALING_DEQUE_H_
@@ -0,0 +1,226 @@
+#ifndef WORK_STEALING_POOL_H_
+#define WORK_STEALING_POOL_H_
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "deque.h"
+#include "work_stealing_deque.h"
+
+// Minimal work-stealing thread pool. Every worker owns a WorkStealingDeque
+// of tasks: tasks submitted from inside a task go to the back of the
+// submitting worker's deque and it runs its newest task first, which keeps
+// recursive work depth-first and cache-warm, while idle workers steal the
+// oldest (usually largest) tasks from the front of others' deques. Tasks
+// submitted from outside the pool go through a shared queue. Workers with
+// nothing to do sleep until a task is submitted.
+class WorkStealingPool {
+ public:
+  typedef std::function<void()> Task;
+
+  // Constructor, starts @threads workers (hardware concurrency if 0)
+  explicit WorkStealingPool(size_t threads = 0);
+  // Destructor, waits for every submitted task, then stops the workers;
+  // exceptions from tasks not collected by Wait() are dropped
+  ~WorkStealingPool();
+
+  // Return the number of worker threads
+  size_t Threads() const noexcept;
+  // Run @task on some worker; safe to call from any thread, including
+  // from inside a task
+  void Submit(Task task);
+  // Block until every task submitted so far, and every task they submit,
+  // has finished, then rethrow the first exception a task threw, if any;
+  // must not be called from inside a task
+  void Wait();
+
+ private:
+    struct Worker {
+      WorkStealingDeque<Task*> tasks;
+      std::thread thread;
+    };
+    std::vector<std::unique_ptr<Worker>> workers;
+    // Tasks submitted from outside the pool
+    Deque<Task*> injected;
+    std::mutex injected_lock;
+    // Tasks submitted but not yet taken by a worker
+    std::atomic<size_t> pending;
+    // Tasks submitted but not yet finished
+    std::atomic<size_t> unfinished;
+    std::atomic<size_t> sleeping;
+    std::atomic<bool> stop;
+    std::mutex lock;
+    std::condition_variable work_ready;
+    std::condition_variable all_done;
+    // First exception thrown by a task since the last Wait()
+    std::exception_ptr error;
+
+    // The pool and index this thread is a worker of, if any; a thread is
+    // a worker of at most one pool, and submitting to another pool from a
+    // task leaves it as it is
+    static std::pair<const WorkStealingPool*, int>& this_worker();
+    // Index of the worker running on this thread in @pool, or -1
+    static int current(const WorkStealingPool *pool);
+    Task* find_task(size_t self, std::minstd_rand &rng);
+    void run(size_t self);
+    void finish_task();
+    void wait_all();
+
+    WorkStealingPool(const WorkStealingPool&) = delete;
+    WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+};
+
+inline WorkStealingPool::WorkStealingPool(size_t threads) : pending(0),
+  unfinished(0), sleeping(0), stop(false) {
+  if (threads == 0) {
+    threads = std::max(1u, std::thread::hardware_concurrency());
+  }
+  for (size_t i = 0; i < threads; i++) {
+    workers.emplace_back(new Worker);
+  }
+  // Start threads only once every deque exists, as they steal from all
+  for (size_t i = 0; i < threads; i++) {
+    workers[i]->thread = std::thread(&WorkStealingPool::run, this, i);
+  }
+}
+
+inline WorkStealingPool::~WorkStealingPool() {
+  wait_all();
+  {
+    std::lock_guard<std::mutex> guard(lock);
+    stop = true;
+  }
+  work_ready.notify_all();
+  for (auto &w : workers) {
+    w->thread.join();
+  }
+}
+
+inline size_t WorkStealingPool::Threads() const noexcept {
+  return workers.size();
+}
+
+inline std::pair<const WorkStealingPool*, int>&
+WorkStealingPool::this_worker() {
+  static thread_local std::pair<const WorkStealingPool*, int> worker(
+    nullptr, -1);
+  return worker;
+}
+
+inline int WorkStealingPool::current(const WorkStealingPool *pool) {
+  return this_worker().first == pool ? this_worker().second : -1;
+}
+
+inline void WorkStealingPool::Submit(Task task) {
+  Task *t = new Task(std::move(task));
+  unfinished++;
+  // Counted before it is visible, so a worker never takes it uncounted
+  pending++;
+  int self = current(this);
+  if (self >= 0) {
+    workers[self]->tasks.Push(t);
+  } else {
+    std::lock_guard<std::mutex> guard(injected_lock);
+    injected.PushBack(t);
+  }
+  // Either a sleeping worker is seen here, or it sees pending > 0 before
+  // it sleeps (both sides use seq_cst)
+  if (sleeping > 0) {
+    std::lock_guard<std::mutex> guard(lock);
+    work_ready.notify_one();
+  }
+}
+
+inline void WorkStealingPool::wait_all() {
+  std::unique_lock<std::mutex> guard(lock);
+  all_done.wait(guard, [this]() { return unfinished == 0; });
+}
+
+inline void WorkStealingPool::Wait() {
+  wait_all();
+  std::exception_ptr e;
+  {
+    std::lock_guard<std::mutex> guard(lock);
+    std::swap(e, error);
+  }
+  if (e) {
+    std::rethrow_exception(e);
+  }
+}
+
+// Own deque first, then the shared queue, then a steal from the others
+// starting at a random victim
+inline WorkStealingPool::Task* WorkStealingPool::find_task(size_t self,
+  std::minstd_rand &rng) {
+  Task *t;
+  if (workers[self]->tasks.Pop(t)) {
+    return t;
+  }
+  {
+    std::lock_guard<std::mutex> guard(injected_lock);
+    if (!injected.Empty()) {
+      return injected.TakeFront();
+    }
+  }
+  size_t n = workers.size();
+  size_t first = rng() % n;
+  for (size_t i = 0; i < n; i++) {
+    size_t victim = (first + i) % n;
+    if (victim != self && workers[victim]->tasks.Steal(t)) {
+      return t;
+    }
+  }
+  return nullptr;
+}
+
+inline void WorkStealingPool::finish_task() {
+  if (--unfinished == 0) {
+    std::lock_guard<std::mutex> guard(lock);
+    all_done.notify_all();
+  }
+}
+
+inline void WorkStealingPool::run(size_t self) {
+  this_worker() = std::make_pair(this, static_cast<int>(self));
+  std::minstd_rand rng(static_cast<unsigned>(self) + 1);
+  while (true) {
+    Task *t = pending > 0 ? find_task(self, rng) : nullptr;
+    if (t) {
+      pending--;
+      try {
+        (*t)();
+      } catch (...) {
+        std::lock_guard<std::mutex> guard(lock);
+        if (!error) {
+          error = std::current_exception();
+        }
+      }
+      delete t;
+      finish_task();
+      continue;
+    }
+    if (pending > 0) {
+      // Work exists but was being taken elsewhere; look again
+      std::this_thread::yield();
+      continue;
+    }
+    std::unique_lock<std::mutex> guard(lock);
+    sleeping++;
+    work_ready.wait(guard, [this]() { return pending > 0 || stop; });
+    sleeping--;
+    if (stop && pending == 0) {
+      return;
+    }
+  }
+}
+
+#endif  // WORK_STEALING_POOL_H_